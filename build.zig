@@ -6,6 +6,8 @@ pub fn build(b: *std.Build) void {
 
     const ort_include = b.option([]const u8, "ort-include", "Path to ONNX Runtime headers (e.g., /usr/include)");
     const ort_lib = b.option([]const u8, "ort-lib", "Path to ONNX Runtime libraries (e.g., /usr/lib)");
+    const embed_model = b.option([]const u8, "embed-model", "Embed this ONNX model or native weights file into the binary (e.g., silero_vad.onnx)");
+    const backend = b.option(Backend, "backend", "Inference backend: ort (default) or native (no ONNX Runtime dependency)") orelse .ort;
 
     const local_ort_root = "onnxruntime-linux-x64-1.18.0";
     const local_ort_include = b.pathJoin(&.{ local_ort_root, "include" });
@@ -22,36 +24,60 @@ pub fn build(b: *std.Build) void {
             .optimize = optimize,
         }),
     });
-    exe.addCSourceFiles(.{
-        .files = &.{
-            "src/main.c",
-            "src/silero_vad.c",
-            "src/wav.c",
-        },
-        .flags = &.{
-            "-std=c23",
-            "-Wall",
-            "-Wextra",
-            "-Wpedantic",
-            "-Werror",
-        },
-    });
+    const c_flags: []const []const u8 = &.{
+        "-std=c23",
+        "-Wall",
+        "-Wextra",
+        "-Wpedantic",
+        "-Werror",
+    };
+    const library_sources: []const []const u8 = &.{
+        "src/silero_vad.c",
+        "src/embedded_model.c",
+        "src/vad_native.c",
+        "src/wav.c",
+    };
+    exe.addCSourceFiles(.{ .files = &.{"src/main.c"}, .flags = c_flags });
+    exe.addCSourceFiles(.{ .files = library_sources, .flags = c_flags });
 
-    exe.addIncludePath(.{ .src_path = .{ .owner = b, .sub_path = "src/include" } });
-    if (ort_include) |inc| {
-        exe.addIncludePath(.{ .cwd_relative = inc });
-    } else if (have_local_include) {
-        exe.addIncludePath(.{ .cwd_relative = local_ort_include });
+    if (embed_model) |model_path| {
+        exe.root_module.addCMacro("SILERO_VAD_EMBED_MODEL", b.fmt("\"{s}\"", .{b.pathFromRoot(model_path)}));
     }
 
-    if (ort_lib) |lib_path| {
-        exe.addLibraryPath(.{ .cwd_relative = lib_path });
-    } else if (have_local_lib) {
-        exe.addLibraryPath(.{ .cwd_relative = local_ort_lib });
-    }
+    // Consistency checks: native vs ORT probabilities, sharded vs single pass
+    const tests = b.addExecutable(.{
+        .name = "vad_test",
+        .root_module = b.createModule(.{
+            .target = target,
+            .optimize = optimize,
+        }),
+    });
+    tests.addCSourceFiles(.{ .files = &.{"tests/vad_test.c"}, .flags = c_flags });
+    tests.addCSourceFiles(.{ .files = library_sources, .flags = c_flags });
+
+    for ([_]*std.Build.Step.Compile{ exe, tests }) |artifact| {
+        artifact.addIncludePath(.{ .src_path = .{ .owner = b, .sub_path = "src/include" } });
+        artifact.linkLibC();
 
-    exe.linkLibC();
-    exe.linkSystemLibrary("onnxruntime");
+        switch (backend) {
+            .ort => {
+                if (ort_include) |inc| {
+                    artifact.addIncludePath(.{ .cwd_relative = inc });
+                } else if (have_local_include) {
+                    artifact.addIncludePath(.{ .cwd_relative = local_ort_include });
+                }
+
+                if (ort_lib) |lib_path| {
+                    artifact.addLibraryPath(.{ .cwd_relative = lib_path });
+                } else if (have_local_lib) {
+                    artifact.addLibraryPath(.{ .cwd_relative = local_ort_lib });
+                }
+
+                artifact.linkSystemLibrary("onnxruntime");
+            },
+            .native => artifact.root_module.addCMacro("SILERO_VAD_NO_ORT", "1"),
+        }
+    }
 
     b.installArtifact(exe);
 
@@ -63,8 +89,18 @@ pub fn build(b: *std.Build) void {
 
     const run_step = b.step("run", "Build and run the VAD demo");
     run_step.dependOn(&run_cmd.step);
+
+    const test_cmd = b.addRunArtifact(tests);
+    if (b.args) |args| {
+        test_cmd.addArgs(args);
+    }
+
+    const test_step = b.step("test", "Check native vs ORT probabilities and sharded vs single-pass segments");
+    test_step.dependOn(&test_cmd.step);
 }
 
+const Backend = enum { ort, native };
+
 fn dirExists(fs: std.fs.Dir, path: []const u8) bool {
     const result = fs.statFile(path) catch return false;
     return result.kind == .directory;
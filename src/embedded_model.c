@@ -0,0 +1,32 @@
+/*
+    embedded_model.c - Optional Silero VAD model compiled into the binary.
+    Enabled by building with -DSILERO_VAD_EMBED_MODEL="<path to .onnx>".
+*/
+
+#include <stddef.h>
+
+#include "silero_vad.h"
+
+#ifdef SILERO_VAD_EMBED_MODEL
+// Read-only data: forked workers share these pages with the parent.
+alignas(64) static const unsigned char embedded_model[] = {
+#embed SILERO_VAD_EMBED_MODEL
+};
+#endif
+
+[[nodiscard]]
+bool vad_embedded_model(const void **model_data, size_t *model_size) {
+  if (model_data == nullptr || model_size == nullptr) {
+    return false;
+  }
+
+#ifdef SILERO_VAD_EMBED_MODEL
+  *model_data = embedded_model;
+  *model_size = sizeof(embedded_model);
+  return true;
+#else
+  *model_data = nullptr;
+  *model_size = 0U;
+  return false;
+#endif
+}
@@ -1,13 +1,29 @@
 #ifndef SILERO_VAD_H_
 #define SILERO_VAD_H_
 
-#include <onnxruntime_c_api.h>
+#include <stdatomic.h>
 #include <stddef.h>
 #include <stdint.h>
 
+#ifdef SILERO_VAD_NO_ORT
+// Native-only build: the ORT handles below stay in the structs, always null
+typedef struct OrtApi OrtApi;
+typedef struct OrtEnv OrtEnv;
+typedef struct OrtSession OrtSession;
+typedef struct OrtSessionOptions OrtSessionOptions;
+typedef struct OrtMemoryInfo OrtMemoryInfo;
+typedef struct OrtValue OrtValue;
+typedef struct OrtIoBinding OrtIoBinding;
+#else
+#include <onnxruntime_c_api.h>
+#endif
+
+#include "vad_native.h"
+
+// Sample positions, 64-bit so a stream can run for as long as it likes
 typedef struct {
-  int start;
-  int end;
+  int64_t start;
+  int64_t end;
 } timestamp_t;
 
 typedef struct {
@@ -16,22 +32,116 @@ typedef struct {
   size_t capacity;
 } timestamp_vector_t;
 
+typedef enum {
+  VAD_SPEECH_START, // the window that triggered speech; speech.end is -1
+  VAD_SPEECH_END,   // the segment is closed and stored in speeches
+} vad_event_type_t;
+
+typedef struct {
+  vad_event_type_t type;
+  timestamp_t speech;
+} vad_event_t;
+
+// Called from inside the window that causes the event, on the thread that
+// runs it
+typedef void (*vad_event_callback_t)(const vad_event_t *event,
+                                     void *user_data);
+
+// Raw score of one window before segmentation: the model output, 0 for a
+// gated window, the held probability inside a stride. `start` is the first
+// sample of the window on the stream's timeline.
+typedef void (*vad_prob_callback_t)(int64_t start, float speech_prob,
+                                    void *user_data);
+
+// Segmentation settings of vad_stream_init, for vad_segment_probs
+typedef struct {
+  int sample_rate;
+  int window_frame_size_ms;
+  float threshold;
+  int min_silence_ms;
+  int speech_pad_ms;
+  int min_speech_ms;
+  float max_speech_s;
+  // Where a segment still open after the last window ends; 0 for the end
+  // of the last window
+  size_t audio_length_samples;
+} vad_segment_params_t;
+
+typedef enum {
+  VAD_GRAPH_OPT_DISABLE,
+  VAD_GRAPH_OPT_BASIC,
+  VAD_GRAPH_OPT_EXTENDED,
+  VAD_GRAPH_OPT_ALL,
+} vad_graph_opt_t;
+
+// ONNX Runtime session tuning, applied when a model is loaded. Start from
+// vad_config_init, which reproduces the historical defaults.
+typedef struct {
+  // Per-session pools; ignored once vad_global_thread_pool_init has run.
+  int intra_op_threads; // 0 lets ORT pick one thread per physical core
+  int inter_op_threads; // only used with parallel_execution
+  vad_graph_opt_t graph_optimization;
+  bool parallel_execution; // ORT_PARALLEL instead of ORT_SEQUENTIAL
+  bool allow_intra_op_spinning; // idle pool threads busy-wait for work
+  bool allow_inter_op_spinning;
+  bool enable_cpu_mem_arena;
+  bool enable_mem_pattern;
+  // Keep the optimized graph as "<stem>.<hash>.opt.onnx" next to the model,
+  // keyed on the model bytes, ORT version, optimization level, execution
+  // mode and thread counts, and load it on later runs without re-optimizing.
+  // File-based loads only. A VAD_GRAPH_OPT_ALL cache can hold kernels fused
+  // for this CPU, so do not copy it to other machines.
+  bool cache_optimized_model;
+} vad_config_t;
+
+// Loaded, optimized model shared by any number of streams. Refcounted; the
+// session is safe to Run from several threads at once. A native weights file
+// sets `native` instead and leaves every ORT handle null.
 typedef struct {
-  // ONNX Runtime Resources
+  vad_native_model_t *native;
   const OrtApi *g_ort;
-  OrtEnv *env;
+  OrtEnv *env; // process-wide, shared by every model
   OrtSession *session;
   OrtSessionOptions *session_options;
   OrtMemoryInfo *memory_info;
-  OrtAllocator *allocator;
+  bool is_16k_only;
+  // Wrapped by tools/wrap_scan.py: input and output carry a leading windows
+  // axis, and one Run steps the LSTM through all of them.
+  bool is_scan;
+  // int8 QDQ graph written by tools/quantize_model.py
+  bool is_quantized;
+  atomic_size_t refcount;
+} vad_model_t;
+
+// Per-stream context, LSTM state, thresholds and segmentation; runs on a
+// shared vad_model_t.
+typedef struct {
+  vad_model_t *model;
+  const vad_native_net_t *native_net; // set when running without ORT
 
   // Buffers and State
-  float *context;
+  // state/state_out ping-pong: each window reads state and writes
+  // state_out, then the pointers (and their tensors and bindings) swap.
   float *state;
+  float *state_out;
   int64_t *sr_tensor_data;
 
   // Persistent Input/Output Buffers
+  // input_buffer is [context | chunk]; the context head carries the tail of
+  // the previous window, so there is no separate context array.
   float *input_buffer;
+  float *output_buffer;
+
+  // Preallocated tensors over the buffers above, bound once at init.
+  // binding reads state_ort and writes state_out_ort; next_binding is the
+  // mirror image used by the following window.
+  OrtValue *input_ort;
+  OrtValue *state_ort;
+  OrtValue *sr_ort;
+  OrtValue *output_ort;
+  OrtValue *state_out_ort;
+  OrtIoBinding *binding;
+  OrtIoBinding *next_binding;
 
   // Configuration
   int sample_rate;
@@ -49,18 +159,174 @@ typedef struct {
   float max_speech_samples;
   int speech_pad_samples;
 
+  // Energy pre-gate, see vad_stream_set_energy_gate. Thresholds apply to
+  // the new samples of a window; gate_energy 0 turns the gate off.
+  float gate_energy; // sum of squares
+  float gate_peak;   // largest magnitude
+
+  // Adaptive stride, see vad_stream_set_adaptive_stride; stride 0 = off
+  int stride_after; // confident inferred windows in a row before striding
+  int stride;
+
   // Logic State
   bool triggered;
-  unsigned int temp_end;
-  unsigned int current_sample;
-  int prev_end;
-  int next_start;
+  int64_t temp_end;
+  int64_t current_sample; // samples since the last reset, whole windows
+  int64_t prev_end;
+  int64_t next_start;
+
+  int confident_run; // confident windows in a row: > 0 speech, < 0 silence
+  int stride_skip;   // windows left before the next inferred one
+  float held_prob;   // last inferred probability, reused while striding
 
   timestamp_t current_speech;
   timestamp_vector_t speeches;
 
-} vad_iterator_t;
+  // Timeline position of the first sample after a reset, added to every
+  // timestamp in speeches and events; see vad_stream_set_epoch
+  int64_t epoch;
+
+  // See vad_stream_set_event_callback; kept across resets
+  vad_event_callback_t on_event;
+  void *event_user_data;
+
+  // See vad_stream_set_prob_callback; kept across resets
+  vad_prob_callback_t on_prob;
+  void *prob_user_data;
+
+  // Windows that skipped inference since the last reset: scored 0 by the
+  // energy gate, or repeating held_prob inside a stride. The total is
+  // current_sample / window_size_samples.
+  size_t windows_gated;
+  size_t windows_strided;
+
+  // Samples of a partial window waiting in input_buffer, see vad_stream_feed
+  size_t pending;
 
+  // Staging of the offline block paths (native and scan), allocated on first
+  // use and kept so repeated feeds do not allocate
+  float *block_scratch;
+  size_t block_scratch_size;
+
+  // When set, windows only store their probability here, by index since
+  // the last reset, and skip segmentation. Used by the shard workers of
+  // vad_iterator_process_parallel.
+  float *prob_log;
+
+} vad_stream_t;
+
+// One stream that owns its model; see vad_iterator_init.
+typedef vad_stream_t vad_iterator_t;
+
+// Advances up to batch_size independent streams with one Run per window.
+typedef struct {
+  vad_model_t *model;
+
+  // Streams own context, state and segmentation but no tensors or bindings
+  vad_stream_t *streams;
+  size_t batch_size;
+
+  // Batched buffers: input [B, effective], state [2, B, 128], output [B]
+  float *input_buffer;
+  float *state;
+  float *state_out;
+  float *output_buffer;
+  int64_t *sr_tensor_data;
+  size_t *rows; // stream index of each active row in the last Run
+
+  // Tensors over the first bound_rows rows of the buffers above
+  OrtValue *input_ort;
+  OrtValue *state_ort;
+  OrtValue *sr_ort;
+  OrtValue *output_ort;
+  OrtValue *state_out_ort;
+  OrtIoBinding *binding;
+  size_t bound_rows;
+} vad_batch_t;
+
+void vad_config_init(vad_config_t *config);
+
+// Size the process-wide ORT thread pools once; every model loaded afterwards
+// attaches to them instead of creating its own threads, so core usage stays
+// bounded however many models and streams are open. Must run before the
+// first model is loaded. Thread counts of 0 let ORT pick.
+[[nodiscard]]
+bool vad_global_thread_pool_init(int intra_op_threads, int inter_op_threads,
+                                 bool allow_spinning);
+// Drop the pools' hold on the runtime; it goes away with the last model.
+void vad_global_thread_pool_free(void);
+
+// `config` may be nullptr for the defaults of vad_config_init. Files and
+// buffers holding native weights (see vad_native.h) are detected by their
+// header and run on the built-in engine; `config` does not apply to them.
+[[nodiscard]]
+vad_model_t *vad_model_load(const char *model_path,
+                            const vad_config_t *config);
+// Parse a model already in memory (e.g. the embedded blob below). The bytes
+// are only read during the call. Assumes the 8k/16k Silero model.
+[[nodiscard]]
+vad_model_t *vad_model_load_from_memory(const void *model_data,
+                                        size_t model_size,
+                                        const vad_config_t *config);
+// Model compiled into the binary with `zig build -Dembed-model=<path>`.
+// Returns false when the build carries no embedded model.
+[[nodiscard]]
+bool vad_embedded_model(const void **model_data, size_t *model_size);
+vad_model_t *vad_model_retain(vad_model_t *model);
+void vad_model_release(vad_model_t *model);
+
+// The stream retains `model`; callers may release their own reference.
+[[nodiscard]]
+bool vad_stream_init(vad_stream_t *stream, vad_model_t *model,
+                     int sample_rate, int window_frame_size_ms,
+                     float threshold, int min_silence_ms, int speech_pad_ms,
+                     int min_speech_ms, float max_speech_s);
+void vad_stream_free(vad_stream_t *stream);
+
+// Optional energy pre-gate, off by default. A window whose new samples have
+// an RMS below rms_dbfs and a peak below peak_dbfs (dB relative to full
+// scale) scores 0 without inference. The LSTM state is held across skipped
+// windows, so the network sees the audio as if those spans were cut out;
+// the context still follows the audio. rms_dbfs = -INFINITY turns the gate
+// off. Batched streams are set through batch->streams[i].
+void vad_stream_set_energy_gate(vad_stream_t *stream, float rms_dbfs,
+                                float peak_dbfs);
+// Segment events as they happen: VAD_SPEECH_START in the window that
+// triggers, VAD_SPEECH_END when the minimum silence (or maximum speech, or
+// the end of the audio) closes the segment. Every start is followed by one
+// end unless the stream is reset in between. nullptr turns them off.
+void vad_stream_set_event_callback(vad_stream_t *stream,
+                                   vad_event_callback_t callback,
+                                   void *user_data);
+// Every window's probability as it is scored, in order, on any path:
+// iterator, parallel, batched and feed. vad_iterator_skip reports only the
+// few windows it lands on, at 0. nullptr turns it off.
+void vad_stream_set_prob_callback(vad_stream_t *stream,
+                                  vad_prob_callback_t callback,
+                                  void *user_data);
+// Windows that processing n_samples runs, the last partial one included
+size_t vad_stream_window_count(const vad_stream_t *stream, size_t n_samples);
+// Put the stream on the caller's timeline: the first sample after a reset
+// is at `first_sample`, e.g. a sample count since some wall-clock origin, and
+// speeches and events report positions from there. Counters stay relative.
+void vad_stream_set_epoch(vad_stream_t *stream, int64_t first_sample);
+// Moves up to `capacity` closed segments, oldest first, out of speeches into
+// out and returns how many. With out nullptr they are only dropped. Long
+// running streams drain what they have consumed to keep memory bounded.
+size_t vad_stream_drain(vad_stream_t *stream, timestamp_t *out,
+                        size_t capacity);
+// Optional adaptive stride for coarse scans, off by default. After
+// confident_windows inferred windows in a row that are clearly silence
+// (below threshold - 0.15) or clearly speech (threshold + 0.15 or more),
+// only every stride-th window runs the model and the ones in between repeat
+// its probability. Full rate resumes once an inferred window leaves that
+// band or changes side. Every window is still segmented, so the minimum
+// silence and speech durations keep their meaning; boundaries move by up to
+// stride - 1 windows. stride <= 1 turns it off.
+void vad_stream_set_adaptive_stride(vad_stream_t *stream,
+                                    int confident_windows, int stride);
+
+// Loads a private model for a single stream.
 [[nodiscard]]
 bool vad_iterator_init(vad_iterator_t *vad, const char *model_path,
                        int sample_rate, int window_frame_size_ms,
@@ -70,6 +336,79 @@ bool vad_iterator_init(vad_iterator_t *vad, const char *model_path,
 void vad_iterator_reset_states(vad_iterator_t *vad);
 void vad_iterator_process(vad_iterator_t *vad, const float *input_wav,
                           size_t audio_length_samples);
+// vad_iterator_process that also stores every window's probability in
+// probs, vad_stream_window_count(vad, audio_length_samples) of them. The _u8
+// variant quantizes to round(p * 255) for a quarter of the memory.
+void vad_iterator_process_probs(vad_iterator_t *vad, const float *input_wav,
+                                size_t audio_length_samples, float *probs);
+void vad_iterator_process_probs_u8(vad_iterator_t *vad,
+                                   const float *input_wav,
+                                   size_t audio_length_samples,
+                                   uint8_t *probs);
+// Segment n stored window probabilities without the model, e.g. to sweep
+// thresholds over probabilities saved by vad_iterator_process_probs. With
+// the same settings and audio length the segments match vad_iterator_process
+// exactly. Writes up to `capacity` of them to out and returns how many there
+// are in all.
+[[nodiscard]]
+size_t vad_segment_probs(const float *probs, size_t n,
+                         const vad_segment_params_t *params, timestamp_t *out,
+                         size_t capacity);
+// vad_iterator_process split into up to `shards` contiguous pieces that run
+// on their own threads, for long recordings. Each piece after the first
+// warms its state on the 2 s before it; segmentation then runs over all
+// windows in order, so shards never cut or duplicate a segment. Only the
+// probabilities of the first windows of a shard can differ from a single
+// pass, and a segment boundary moves only where one of them sits at a
+// threshold. Short audio, or a stream with an adaptive stride, takes the
+// single pass.
+void vad_iterator_process_parallel(vad_iterator_t *vad,
+                                   const float *input_wav,
+                                   size_t audio_length_samples,
+                                   size_t shards);
+// Push streaming for live audio in frames of any size. Feed never resets:
+// it keeps a partial window until the next call completes it and runs every
+// whole window as soon as it is there, so speeches grows as audio arrives.
+// Flush runs the last partial window zero-padded and closes open speech at
+// the end of the fed audio; reset the stream before feeding a new one.
+void vad_stream_feed(vad_stream_t *stream, const float *samples, size_t n);
+void vad_stream_flush(vad_stream_t *stream);
+// Advance over n_samples known to be silent without running the model.
+// Segmentation ends up as if every window had scored 0, in a few steps
+// whatever the length or threshold; state and context start over as after a
+// reset. Any vad_stream_t can skip, batch streams included. The gap first
+// completes a partial window fed before it with zeros, which then runs; the
+// samples past its last whole window stay pending as zeros, so windows keep
+// their grid.
+void vad_iterator_skip(vad_iterator_t *vad, size_t n_samples);
 void vad_iterator_free(vad_iterator_t *vad);
 
+[[nodiscard]]
+bool vad_batch_init(vad_batch_t *batch, vad_model_t *model, size_t batch_size,
+                    int sample_rate, int window_frame_size_ms, float threshold,
+                    int min_silence_ms, int speech_pad_ms, int min_speech_ms,
+                    float max_speech_s);
+
+void vad_batch_reset_stream(vad_batch_t *batch, size_t index);
+// chunks[i] is the next window_size_samples of stream i, or nullptr to leave
+// stream i idle for this step. Active streams share a single Run.
+void vad_batch_process(vad_batch_t *batch, const float *const *chunks);
+// Close a segment left open when stream `index` ends after
+// audio_length_samples samples; results are in streams[index].speeches.
+void vad_batch_finish_stream(vad_batch_t *batch, size_t index,
+                             size_t audio_length_samples);
+// vad_iterator_process_parallel on one thread: the shards become lanes of
+// the batch, which all step one window per Run. Segments land in vad, with
+// its thresholds and energy gate. The lanes run without a stride and are left
+// reset, with their own stride and gate settings back in place.
+// The lanes are reset without any check: pending audio, recurrent state and
+// speeches (including an open segment) of the streams in use are discarded,
+// so only pass a batch that is idle between files.
+// Falls back to the single pass on native weights, or when the batch was
+// initialized with another sample rate or window size than vad.
+void vad_iterator_process_batched(vad_iterator_t *vad, vad_batch_t *batch,
+                                  const float *input_wav,
+                                  size_t audio_length_samples);
+void vad_batch_free(vad_batch_t *batch);
+
 #endif /* SILERO_VAD_H_ */
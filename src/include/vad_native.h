@@ -0,0 +1,105 @@
+/*
+    vad_native.h - ONNX Runtime-free Silero VAD v5 inference.
+    Runs the STFT, encoder, LSTM cell and decoder directly from a weights
+    file written by tools/extract_weights.py.
+*/
+
+#ifndef SILERO_VAD_NATIVE_H_
+#define SILERO_VAD_NATIVE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define VAD_NATIVE_ENCODER_LAYERS 4
+
+// Conv1d + ReLU. Weights are repacked at load as [kernel][in][out] so the
+// innermost loop runs over contiguous output channels.
+typedef struct {
+  const float *weight;
+  const float *bias; // [out_channels]
+  unsigned int in_channels;
+  unsigned int out_channels;
+  unsigned int kernel_size;
+  unsigned int stride;
+  unsigned int padding;
+} vad_native_conv_t;
+
+// The graph for one sample rate
+typedef struct {
+  int sample_rate;
+
+  // STFT as a strided convolution over the reflect-padded window
+  unsigned int filter_length;
+  unsigned int hop_length;
+  unsigned int pad_right;
+  unsigned int bins;   // filter_length / 2 + 1
+  const float *basis;  // [filter_length][2 * bins], real then imaginary
+
+  vad_native_conv_t encoder[VAD_NATIVE_ENCODER_LAYERS];
+
+  // LSTM cell over [x | h]: weight [input + hidden][4 * hidden], gates in
+  // ONNX order i, o, f, c; input and recurrent biases are pre-summed.
+  unsigned int lstm_input;
+  unsigned int hidden;
+  const float *lstm_weight;
+  const float *lstm_bias;
+
+  // ReLU, 1x1 conv to a single logit, sigmoid
+  const float *decoder_weight; // [hidden]
+  float decoder_bias;
+} vad_native_net_t;
+
+typedef struct {
+  vad_native_net_t nets[2]; // 16 kHz and/or 8 kHz
+  size_t net_count;
+  float *weights; // one 64-byte aligned block behind every pointer above
+} vad_native_model_t;
+
+// True when the bytes start like a native weights file rather than ONNX
+[[nodiscard]]
+bool vad_native_probe(const void *data, size_t size);
+[[nodiscard]]
+bool vad_native_probe_file(const char *path);
+
+[[nodiscard]]
+vad_native_model_t *vad_native_load(const void *data, size_t size);
+[[nodiscard]]
+vad_native_model_t *vad_native_load_file(const char *path);
+void vad_native_free(vad_native_model_t *model);
+
+// nullptr when the file carries no graph for this rate
+[[nodiscard]]
+const vad_native_net_t *vad_native_net_for(const vad_native_model_t *model,
+                                           int sample_rate);
+// Whether windows of input_samples (context included) reduce to the single
+// encoder frame the LSTM cell expects and fit the fixed scratch space.
+[[nodiscard]]
+bool vad_native_supports(const vad_native_net_t *net, size_t input_samples);
+
+// One window. state and state_out are [2, 1, hidden] (h then c), as in the
+// ONNX model, and must not overlap. Allocation-free.
+[[nodiscard]]
+float vad_native_run(const vad_native_net_t *net, const float *input,
+                     size_t input_samples, const float *state,
+                     float *state_out);
+
+// vad_native_run in two halves, for offline use. The STFT and encoder only
+// see the window's own samples, so many windows can go through them in one
+// call; only the LSTM step has to follow the audio order.
+
+// Floats of workspace vad_native_encode needs; 0 if the shape is unsupported
+[[nodiscard]]
+size_t vad_native_workspace_size(const vad_native_net_t *net,
+                                 size_t input_samples, size_t windows);
+// Window i is input[i * stride, i * stride + input_samples). Writes
+// features [windows][4 * hidden]: the input half of the LSTM gates, bias
+// included, the same as one window at a time would compute.
+void vad_native_encode(const vad_native_net_t *net, const float *input,
+                       size_t stride, size_t input_samples, size_t windows,
+                       float *workspace, float *features);
+// LSTM step and decoder on one window's features; returns the probability
+[[nodiscard]]
+float vad_native_decode(const vad_native_net_t *net, const float *features,
+                        const float *state, float *state_out);
+
+#endif /* SILERO_VAD_NATIVE_H_ */
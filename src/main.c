@@ -1,14 +1,20 @@
+#include <dirent.h>
 #include <math.h>
+#include <stdatomic.h>
 #include <stdckdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <threads.h>
 
 #include "silero_vad.h"
 #include "wav.h"
 
 [[nodiscard]]
 static bool write_segment(const wav_reader_t *reader, timestamp_t ts,
-                          size_t index, const char *directory) {
+                          size_t index, const char *directory,
+                          const char *prefix) {
   if (reader == nullptr || reader->data == nullptr || directory == nullptr) {
     return false;
   }
@@ -40,9 +46,9 @@ static bool write_segment(const wav_reader_t *reader, timestamp_t ts,
   const float *segment_data =
       reader->data + start * (size_t)reader->num_channel;
 
-  char filename[128];
-  int written = snprintf(filename, sizeof(filename), "%s/segment_%zu.wav",
-                         directory, index);
+  char filename[1'024];
+  int written = snprintf(filename, sizeof(filename), "%s/%ssegment_%zu.wav",
+                         directory, prefix, index);
   if (written <= 0 || written >= (int)sizeof(filename)) {
     return false;
   }
@@ -58,7 +64,56 @@ static bool write_segment(const wav_reader_t *reader, timestamp_t ts,
   return true;
 }
 
-int main() {
+#ifdef SILERO_VAD_NO_ORT
+constexpr char model_path[] = "silero_vad.weights";
+#else
+constexpr char model_path[] = "silero_vad.onnx";
+#endif
+
+constexpr int window_ms = 32;
+
+// Command line settings; the defaults match the C++ constructor
+typedef struct {
+  const char *model_path; // nullptr: embedded model, else model_path
+  const char *output_directory; // nullptr: print segments only
+  float threshold;
+  int min_silence_ms;
+  int speech_pad_ms;
+  int min_speech_ms;
+  size_t slots;   // files per batched Run in corpus mode
+  size_t threads; // pool workers; 0 selects corpus mode
+} options_t;
+
+static void options_init(options_t *options) {
+  *options = (options_t){
+      .threshold = 0.5f,
+      .min_silence_ms = 100,
+      .speech_pad_ms = 30,
+      .min_speech_ms = 250,
+      .slots = 32,
+  };
+}
+
+// Prefer a model compiled into the binary over the file next to it, unless
+// one was named
+[[nodiscard]]
+static vad_model_t *load_model(const options_t *options) {
+  const void *model_data = nullptr;
+  size_t model_size = 0;
+  if (options->model_path == nullptr &&
+      vad_embedded_model(&model_data, &model_size)) {
+    fprintf(stderr, "Initializing VAD with embedded model (%zu bytes)\n",
+            model_size);
+    return vad_model_load_from_memory(model_data, model_size, nullptr);
+  }
+  const char *path =
+      options->model_path != nullptr ? options->model_path : model_path;
+  fprintf(stderr, "Initializing VAD with model: %s\n", path);
+  return vad_model_load(path, nullptr);
+}
+
+// The original demo: test.wav through one iterator, segments to audio/
+static int run_demo(const options_t *options) {
   // 1. Read WAV
   constexpr char input_file[] = "test.wav";
   wav_reader_t reader;
@@ -69,11 +124,9 @@ int main() {
   }
 
   // 2. Init VAD
-  constexpr char model_path[] = "silero_vad.onnx";
   vad_iterator_t vad;
 
   // Default params matching C++ constructor defaults
-  printf("Initializing VAD with model: %s\n", model_path);
   const int sample_rate = reader.sample_rate;
   if (sample_rate != 8'000 && sample_rate != 16'000) {
     fprintf(stderr, "Unsupported sample rate: %d (expected 8'000 or 16'000)\n",
@@ -81,9 +134,15 @@ int main() {
     wav_reader_close(&reader);
     return EXIT_FAILURE;
   }
-  constexpr int window_ms = 32;
-  if (!vad_iterator_init(&vad, model_path, sample_rate, window_ms, 0.5f, 100,
-                         30, 250, INFINITY)) {
+
+  vad_model_t *model = load_model(options);
+  const bool vad_ready =
+      model != nullptr &&
+      vad_stream_init(&vad, model, sample_rate, window_ms, options->threshold,
+                      options->min_silence_ms, options->speech_pad_ms,
+                      options->min_speech_ms, INFINITY);
+  vad_model_release(model);
+  if (!vad_ready) {
     fprintf(stderr, "Failed to initialize VAD\n");
     wav_reader_close(&reader);
     return EXIT_FAILURE;
@@ -94,19 +153,19 @@ int main() {
   vad_iterator_process(&vad, reader.data, reader.num_samples);
 
   // 4. Output Results
-  const float sample_rate_float = (float)sample_rate;
+  // Positions are 64-bit; a float would lose sub-window precision within
+  // minutes, so seconds are computed in double
+  const double sample_rate_double = (double)sample_rate;
   constexpr char output_directory[] = "audio";
   size_t segment_index = 0;
 
   for (size_t i = 0; i < vad.speeches.size; i++) {
     const auto ts = vad.speeches.data[i];
-    const auto start_sec =
-        rintf((ts.start / sample_rate_float) * 10.0f) / 10.0f;
-    const auto end_sec = rintf((ts.end / sample_rate_float) * 10.0f) / 10.0f;
-
-    printf("Speech detected from %.1f s to %.1f s\n", start_sec, end_sec);
+    printf("Speech detected from %.3f s to %.3f s\n",
+           (double)ts.start / sample_rate_double,
+           (double)ts.end / sample_rate_double);
 
-    if (write_segment(&reader, ts, segment_index, output_directory)) {
+    if (write_segment(&reader, ts, segment_index, output_directory, "")) {
       printf("  -> Saved segment to %s/segment_%zu.wav\n", output_directory,
              segment_index);
       segment_index++;
@@ -119,3 +178,673 @@ int main() {
 
   return EXIT_SUCCESS;
 }
+
+/* --- Corpus Mode --- */
+
+// Files of one sample rate sharing a batch: every slot holds an open file,
+// and each batched Run advances all of them by one window. A finished file
+// hands its slot to the next one.
+typedef struct {
+  vad_batch_t batch;
+  const options_t *options;
+  wav_reader_t *readers;
+  const char **names;
+  const char **stems;
+  size_t *positions;
+  float *tails; // [slots][window] zero-padded last windows
+  const float **chunks;
+  size_t active;
+  bool ready;
+} corpus_t;
+
+[[nodiscard]]
+static bool corpus_init(corpus_t *corpus, const options_t *options,
+                        vad_model_t *model, int sample_rate) {
+  memset(corpus, 0, sizeof(*corpus));
+  const size_t slots = options->slots;
+  if (!vad_batch_init(&corpus->batch, model, slots, sample_rate, window_ms,
+                      options->threshold, options->min_silence_ms,
+                      options->speech_pad_ms, options->min_speech_ms,
+                      INFINITY)) {
+    return false;
+  }
+  corpus->options = options;
+  const size_t window = (size_t)corpus->batch.streams[0].window_size_samples;
+  corpus->readers = (wav_reader_t *)calloc(slots, sizeof(wav_reader_t));
+  corpus->names = (const char **)calloc(slots, sizeof(char *));
+  corpus->stems = (const char **)calloc(slots, sizeof(char *));
+  corpus->positions = (size_t *)calloc(slots, sizeof(size_t));
+  corpus->tails = (float *)calloc(slots * window, sizeof(float));
+  corpus->chunks = (const float **)calloc(slots, sizeof(float *));
+  corpus->ready = corpus->readers != nullptr && corpus->names != nullptr &&
+                  corpus->stems != nullptr && corpus->positions != nullptr &&
+                  corpus->tails != nullptr && corpus->chunks != nullptr;
+  return corpus->ready;
+}
+
+static void corpus_free(corpus_t *corpus) {
+  // names marks the open readers, so both must exist (an OOM in init may
+  // leave either one null)
+  if (corpus->readers != nullptr && corpus->names != nullptr) {
+    for (size_t i = 0; i < corpus->batch.batch_size; i++) {
+      if (corpus->names[i] != nullptr) {
+        wav_reader_close(&corpus->readers[i]);
+      }
+    }
+  }
+  vad_batch_free(&corpus->batch);
+  free(corpus->readers);
+  free(corpus->names);
+  free(corpus->stems);
+  free(corpus->positions);
+  free(corpus->tails);
+  free(corpus->chunks);
+  memset(corpus, 0, sizeof(*corpus));
+}
+
+// One line of segments per file; with an output directory, each segment is
+// also saved as <directory>/<stem>_segment_<n>.wav, stem being the file's
+// unique output name (see path_list_name_outputs)
+static void report_file(const options_t *options, const char *name,
+                        const char *stem, const wav_reader_t *reader,
+                        const timestamp_vector_t *speeches) {
+  const double sample_rate_double = (double)reader->sample_rate;
+  printf("%s:", name);
+  for (size_t i = 0; i < speeches->size; i++) {
+    const auto ts = speeches->data[i];
+    printf(" %.3f-%.3f", (double)ts.start / sample_rate_double,
+           (double)ts.end / sample_rate_double);
+  }
+  printf("\n");
+  fflush(stdout);
+
+  if (options->output_directory == nullptr) {
+    return;
+  }
+  char prefix[256];
+  const int written = snprintf(prefix, sizeof(prefix), "%s_", stem);
+  if (written <= 0 || written >= (int)sizeof(prefix)) {
+    fprintf(stderr, "%s: output name too long\n", name);
+    return;
+  }
+  for (size_t i = 0; i < speeches->size; i++) {
+    (void)write_segment(reader, speeches->data[i], i,
+                        options->output_directory, prefix);
+  }
+}
+
+// One batched Run over every open file; files that ran out are reported and
+// leave their slots free
+static void corpus_step(corpus_t *corpus) {
+  const auto batch = &corpus->batch;
+  const size_t window = (size_t)batch->streams[0].window_size_samples;
+  for (size_t i = 0; i < batch->batch_size; i++) {
+    corpus->chunks[i] = nullptr;
+    const auto reader = &corpus->readers[i];
+    const size_t j = corpus->positions[i];
+    if (corpus->names[i] == nullptr || j >= reader->num_samples) {
+      continue;
+    }
+    if (j + window <= reader->num_samples) {
+      corpus->chunks[i] = reader->data + j;
+    } else {
+      float *tail = corpus->tails + i * window;
+      const size_t remaining = reader->num_samples - j;
+      memcpy(tail, reader->data + j, remaining * sizeof(float));
+      memset(tail + remaining, 0, (window - remaining) * sizeof(float));
+      corpus->chunks[i] = tail;
+    }
+  }
+  vad_batch_process(batch, corpus->chunks);
+
+  for (size_t i = 0; i < batch->batch_size; i++) {
+    if (corpus->names[i] == nullptr) {
+      continue;
+    }
+    const auto reader = &corpus->readers[i];
+    corpus->positions[i] += window;
+    if (corpus->positions[i] < reader->num_samples) {
+      continue;
+    }
+    vad_batch_finish_stream(batch, i, reader->num_samples);
+    report_file(corpus->options, corpus->names[i], corpus->stems[i], reader,
+                &batch->streams[i].speeches);
+    wav_reader_close(reader);
+    vad_batch_reset_stream(batch, i);
+    corpus->names[i] = nullptr;
+    corpus->active--;
+  }
+}
+
+// Open the file into a free slot, stepping the batch until one frees up
+static void corpus_add(corpus_t *corpus, const wav_reader_t *reader,
+                       const char *name, const char *stem) {
+  while (corpus->active == corpus->batch.batch_size) {
+    corpus_step(corpus);
+  }
+  size_t slot = 0;
+  while (corpus->names[slot] != nullptr) {
+    slot++;
+  }
+  corpus->readers[slot] = *reader;
+  corpus->names[slot] = name;
+  corpus->stems[slot] = stem;
+  corpus->positions[slot] = 0;
+  corpus->active++;
+}
+
+// Sample rates the model takes, and their index into per-rate state
+constexpr int rates[] = {16'000, 8'000};
+constexpr size_t rate_count = sizeof(rates) / sizeof(rates[0]);
+
+static size_t rate_index(int sample_rate) {
+  size_t r = 0;
+  while (r < rate_count && rates[r] != sample_rate) {
+    r++;
+  }
+  return r;
+}
+
+static int run_corpus(const options_t *options, vad_model_t *model,
+                      char *const *files, char *const *stems,
+                      size_t file_count) {
+  // A corpus per rate, set up on first use
+  corpus_t corpora[sizeof(rates) / sizeof(rates[0])] = {};
+  int status = EXIT_SUCCESS;
+  for (size_t f = 0; f < file_count; f++) {
+    wav_reader_t reader;
+    if (!wav_reader_open(&reader, files[f])) {
+      fprintf(stderr, "%s: cannot read\n", files[f]);
+      status = EXIT_FAILURE;
+      continue;
+    }
+    const size_t r = rate_index(reader.sample_rate);
+    if (r == rate_count) {
+      fprintf(stderr, "%s: unsupported sample rate %d\n", files[f],
+              reader.sample_rate);
+      wav_reader_close(&reader);
+      status = EXIT_FAILURE;
+      continue;
+    }
+    if (!corpora[r].ready &&
+        !corpus_init(&corpora[r], options, model, reader.sample_rate)) {
+      corpus_free(&corpora[r]);
+      fprintf(stderr, "%s: cannot set up a %d Hz batch\n", files[f],
+              reader.sample_rate);
+      wav_reader_close(&reader);
+      status = EXIT_FAILURE;
+      continue;
+    }
+    corpus_add(&corpora[r], &reader, files[f], stems[f]);
+  }
+
+  for (size_t r = 0; r < rate_count; r++) {
+    while (corpora[r].active > 0U) {
+      corpus_step(&corpora[r]);
+    }
+    corpus_free(&corpora[r]);
+  }
+  return status;
+}
+
+/* --- Worker Pool --- */
+
+// Each worker owns a deque of file indices. It takes from the back of its
+// own and, once that is empty, steals from the front of the others', so a
+// worker stuck on a long file does not hold up the files queued behind it.
+typedef struct pool pool_t;
+
+typedef struct {
+  pool_t *pool;
+  size_t index;
+  thrd_t thread;
+  mtx_t lock;
+  size_t *jobs;
+  size_t head; // next job to steal
+  size_t tail; // one past the next job to take
+  vad_iterator_t streams[sizeof(rates) / sizeof(rates[0])];
+  bool ready[sizeof(rates) / sizeof(rates[0])];
+} worker_t;
+
+struct pool {
+  const options_t *options;
+  vad_model_t *model;
+  char *const *files;
+  char *const *stems;
+  worker_t *workers;
+  size_t worker_count;
+  mtx_t output; // one file's report at a time
+  atomic_bool failed;
+};
+
+[[nodiscard]]
+static bool worker_take(worker_t *worker, size_t *job) {
+  mtx_lock(&worker->lock);
+  const bool found = worker->head < worker->tail;
+  if (found) {
+    *job = worker->jobs[--worker->tail];
+  }
+  mtx_unlock(&worker->lock);
+  if (found) {
+    return true;
+  }
+
+  // Nothing is queued after the start, so empty deques stay empty
+  const auto pool = worker->pool;
+  for (size_t k = 1; k < pool->worker_count; k++) {
+    const auto victim =
+        &pool->workers[(worker->index + k) % pool->worker_count];
+    mtx_lock(&victim->lock);
+    const bool stolen = victim->head < victim->tail;
+    if (stolen) {
+      *job = victim->jobs[victim->head++];
+    }
+    mtx_unlock(&victim->lock);
+    if (stolen) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void worker_process(worker_t *worker, size_t job) {
+  const auto pool = worker->pool;
+  const auto options = pool->options;
+  const char *path = pool->files[job];
+  wav_reader_t reader;
+  if (!wav_reader_open(&reader, path)) {
+    fprintf(stderr, "%s: cannot read\n", path);
+    atomic_store(&pool->failed, true);
+    return;
+  }
+
+  // The worker's iterator for this rate, set up on first use
+  const size_t r = rate_index(reader.sample_rate);
+  if (r < rate_count && !worker->ready[r]) {
+    worker->ready[r] = vad_stream_init(
+        &worker->streams[r], pool->model, reader.sample_rate, window_ms,
+        options->threshold, options->min_silence_ms, options->speech_pad_ms,
+        options->min_speech_ms, INFINITY);
+  }
+  if (r == rate_count || !worker->ready[r]) {
+    fprintf(stderr, "%s: cannot run at %d Hz\n", path, reader.sample_rate);
+    atomic_store(&pool->failed, true);
+    wav_reader_close(&reader);
+    return;
+  }
+
+  const auto vad = &worker->streams[r];
+  vad_iterator_process(vad, reader.data, reader.num_samples);
+  mtx_lock(&pool->output);
+  report_file(options, path, pool->stems[job], &reader, &vad->speeches);
+  mtx_unlock(&pool->output);
+  wav_reader_close(&reader);
+}
+
+static int worker_run(void *arg) {
+  worker_t *worker = arg;
+  size_t job = 0;
+  while (worker_take(worker, &job)) {
+    worker_process(worker, job);
+  }
+  return 0;
+}
+
+static int run_pool(const options_t *options, vad_model_t *model,
+                    char *const *files, char *const *stems,
+                    size_t file_count) {
+  pool_t pool = {
+      .options = options,
+      .model = model,
+      .files = files,
+      .stems = stems,
+      .worker_count = options->threads,
+  };
+  atomic_init(&pool.failed, false);
+  pool.workers = (worker_t *)calloc(pool.worker_count, sizeof(worker_t));
+  auto jobs = (size_t *)malloc(file_count * sizeof(size_t));
+  if (pool.workers == nullptr || jobs == nullptr ||
+      mtx_init(&pool.output, mtx_plain) != thrd_success) {
+    free(pool.workers);
+    free(jobs);
+    fprintf(stderr, "Failed to set up %zu workers\n", pool.worker_count);
+    return EXIT_FAILURE;
+  }
+
+  // Deal the files out in contiguous runs; stealing evens out the rest
+  for (size_t f = 0; f < file_count; f++) {
+    jobs[f] = f;
+  }
+  size_t initialized = 0;
+  for (; initialized < pool.worker_count; initialized++) {
+    const auto worker = &pool.workers[initialized];
+    if (mtx_init(&worker->lock, mtx_plain) != thrd_success) {
+      break;
+    }
+    worker->pool = &pool;
+    worker->index = initialized;
+    worker->jobs = jobs;
+    worker->head = initialized * file_count / pool.worker_count;
+    worker->tail = (initialized + 1U) * file_count / pool.worker_count;
+  }
+  // A worker without a lock gives its share to the last one that has one
+  if (initialized < pool.worker_count) {
+    if (initialized == 0U) {
+      fprintf(stderr, "Failed to set up %zu workers\n", pool.worker_count);
+      mtx_destroy(&pool.output);
+      free(pool.workers);
+      free(jobs);
+      return EXIT_FAILURE;
+    }
+    pool.workers[initialized - 1U].tail = file_count;
+    pool.worker_count = initialized;
+  }
+
+  // Worker 0 runs here, as does any worker whose thread cannot start
+  bool *started = (bool *)calloc(pool.worker_count, sizeof(bool));
+  for (size_t i = 1; started != nullptr && i < pool.worker_count; i++) {
+    started[i] = thrd_create(&pool.workers[i].thread, worker_run,
+                             &pool.workers[i]) == thrd_success;
+  }
+  worker_run(&pool.workers[0]);
+  for (size_t i = 1; i < pool.worker_count; i++) {
+    if (started != nullptr && started[i]) {
+      thrd_join(pool.workers[i].thread, nullptr);
+    }
+  }
+  // Whatever a worker that never started had queued, worker 0 steals
+  worker_run(&pool.workers[0]);
+
+  for (size_t i = 0; i < pool.worker_count; i++) {
+    const auto worker = &pool.workers[i];
+    for (size_t r = 0; r < rate_count; r++) {
+      if (worker->ready[r]) {
+        vad_iterator_free(&worker->streams[r]);
+      }
+    }
+    mtx_destroy(&worker->lock);
+  }
+  mtx_destroy(&pool.output);
+  free(started);
+  free(pool.workers);
+  free(jobs);
+  return atomic_load(&pool.failed) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* --- Command Line --- */
+
+typedef struct {
+  char **paths;
+  char **stems; // output name of each path, see path_list_name_outputs
+  size_t size;
+  size_t capacity;
+} path_list_t;
+
+[[nodiscard]]
+static bool path_list_push(path_list_t *list, const char *path) {
+  if (list->size == list->capacity) {
+    const size_t capacity = list->capacity == 0U ? 64U : list->capacity * 2U;
+    auto paths = (char **)realloc(list->paths, capacity * sizeof(char *));
+    if (paths == nullptr) {
+      return false;
+    }
+    list->paths = paths;
+    list->capacity = capacity;
+  }
+  list->paths[list->size] = strdup(path);
+  return list->paths[list->size++] != nullptr;
+}
+
+static void path_list_free(path_list_t *list) {
+  for (size_t i = 0; i < list->size; i++) {
+    free(list->paths[i]);
+    if (list->stems != nullptr) {
+      free(list->stems[i]);
+    }
+  }
+  free(list->paths);
+  free(list->stems);
+  *list = (path_list_t){};
+}
+
+static int compare_paths(const void *a, const void *b) {
+  return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+// The .wav files directly inside a directory, in name order
+[[nodiscard]]
+static bool add_directory(path_list_t *list, const char *directory) {
+  DIR *dir = opendir(directory);
+  if (dir == nullptr) {
+    fprintf(stderr, "%s: cannot open directory\n", directory);
+    return false;
+  }
+  const size_t first = list->size;
+  bool ok = true;
+  const struct dirent *entry = nullptr;
+  while (ok && (entry = readdir(dir)) != nullptr) {
+    const char *extension = strrchr(entry->d_name, '.');
+    if (extension == nullptr || strcmp(extension, ".wav") != 0) {
+      continue;
+    }
+    char path[1'024];
+    const int written =
+        snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name);
+    ok = written > 0 && written < (int)sizeof(path) &&
+         path_list_push(list, path);
+  }
+  closedir(dir);
+  qsort(list->paths + first, list->size - first, sizeof(char *),
+        compare_paths);
+  return ok;
+}
+
+// A manifest lists one input per line; blank lines and # comments are skipped
+[[nodiscard]]
+static bool add_manifest(path_list_t *list, const char *manifest) {
+  FILE *fp = fopen(manifest, "r");
+  if (fp == nullptr) {
+    fprintf(stderr, "%s: cannot open manifest\n", manifest);
+    return false;
+  }
+  bool ok = true;
+  char line[1'024];
+  while (ok && fgets(line, sizeof(line), fp) != nullptr) {
+    line[strcspn(line, "\r\n")] = '\0';
+    if (line[0] != '\0' && line[0] != '#') {
+      ok = path_list_push(list, line);
+    }
+  }
+  fclose(fp);
+  return ok;
+}
+
+[[nodiscard]]
+static bool add_input(path_list_t *list, const char *path) {
+  struct stat info;
+  if (stat(path, &info) == 0 && S_ISDIR(info.st_mode)) {
+    return add_directory(list, path);
+  }
+  return path_list_push(list, path);
+}
+
+typedef struct {
+  const char *name;
+  size_t index;
+} stem_entry_t;
+
+static int compare_stem_names(const void *a, const void *b) {
+  return strcmp(((const stem_entry_t *)a)->name,
+                ((const stem_entry_t *)b)->name);
+}
+
+// Equal names in input order, so the first file keeps the plain name
+static int compare_stems(const void *a, const void *b) {
+  const int order = compare_stem_names(a, b);
+  if (order != 0) {
+    return order;
+  }
+  const size_t x = ((const stem_entry_t *)a)->index;
+  const size_t y = ((const stem_entry_t *)b)->index;
+  return (x > y) - (x < y);
+}
+
+// Output names: each file's name without its extension. Inputs from
+// different directories can share one, so every later file with a name
+// already taken becomes <name>-<n>, with the lowest n >= 2 that no input is
+// named; no two inputs ever write over each other's segments.
+[[nodiscard]]
+static bool path_list_name_outputs(path_list_t *list) {
+  list->stems = (char **)calloc(list->size, sizeof(char *));
+  auto sorted = (stem_entry_t *)calloc(list->size, sizeof(stem_entry_t));
+  bool ok = list->stems != nullptr && sorted != nullptr;
+  for (size_t i = 0; ok && i < list->size; i++) {
+    const char *base = strrchr(list->paths[i], '/');
+    base = base != nullptr ? base + 1 : list->paths[i];
+    const char *extension = strrchr(base, '.');
+    const size_t length =
+        extension != nullptr ? (size_t)(extension - base) : strlen(base);
+    list->stems[i] = strndup(base, length);
+    sorted[i] = (stem_entry_t){list->stems[i], i};
+    ok = list->stems[i] != nullptr;
+  }
+  if (ok) {
+    qsort(sorted, list->size, sizeof(stem_entry_t), compare_stems);
+  }
+
+  // The sorted entries keep pointing at the plain names until the end
+  size_t copy = 1;
+  for (size_t i = 1; ok && i < list->size; i++) {
+    const auto entry = &sorted[i];
+    if (strcmp(entry->name, sorted[i - 1].name) != 0) {
+      copy = 1;
+      continue;
+    }
+    const size_t size = strlen(entry->name) + 24U;
+    char *renamed = (char *)malloc(size);
+    ok = renamed != nullptr;
+    for (bool taken = true; ok && taken;) {
+      snprintf(renamed, size, "%s-%zu", entry->name, ++copy);
+      const stem_entry_t key = {renamed, 0};
+      taken = bsearch(&key, sorted, list->size, sizeof(stem_entry_t),
+                      compare_stem_names) != nullptr;
+    }
+    list->stems[entry->index] = renamed;
+  }
+  for (size_t i = 0; sorted != nullptr && list->stems != nullptr &&
+                     i < list->size;
+       i++) {
+    if (list->stems[sorted[i].index] != sorted[i].name) {
+      free((char *)sorted[i].name);
+    }
+  }
+  free(sorted);
+  return ok;
+}
+
+static void usage(const char *program) {
+  fprintf(stderr,
+          "usage: %s [options] [file.wav | directory]...\n"
+          "  --manifest FILE     also read inputs from FILE, one per line\n"
+          "  --model PATH        model or native weights to load\n"
+          "  --threshold P       speech probability threshold (0.5)\n"
+          "  --min-silence MS    silence that ends a segment (100)\n"
+          "  --min-speech MS     shortest segment kept (250)\n"
+          "  --speech-pad MS     padding around segments (30)\n"
+          "  --output DIR        save segments as DIR/<file>_segment_<n>.wav;\n"
+          "                      repeated file names become <file>-2, -3, ...\n"
+          "  --threads N         N workers, one iterator each, stealing files\n"
+          "  --batch N           without --threads: files per batched Run "
+          "(32)\n"
+          "Without inputs, runs test.wav and saves its segments in audio/.\n",
+          program);
+}
+
+[[nodiscard]]
+static bool parse_count(const char *text, long *value) {
+  char *end = nullptr;
+  *value = strtol(text, &end, 10);
+  return end != text && *end == '\0';
+}
+
+int main(int argc, char **argv) {
+  options_t options;
+  options_init(&options);
+  path_list_t inputs = {};
+
+  bool ok = true;
+  for (int i = 1; ok && i < argc; i++) {
+    const char *arg = argv[i];
+    if (arg[0] != '-') {
+      ok = add_input(&inputs, arg);
+      continue;
+    }
+    if (i + 1 >= argc) {
+      ok = false;
+      break;
+    }
+    const char *value = argv[++i];
+    long number = 0;
+    char *end = nullptr;
+    if (strcmp(arg, "--manifest") == 0) {
+      ok = add_manifest(&inputs, value);
+    } else if (strcmp(arg, "--model") == 0) {
+      options.model_path = value;
+    } else if (strcmp(arg, "--output") == 0) {
+      options.output_directory = value;
+    } else if (strcmp(arg, "--threshold") == 0) {
+      options.threshold = strtof(value, &end);
+      ok = end != value && *end == '\0' && options.threshold > 0.0f &&
+           options.threshold < 1.0f;
+    } else if (strcmp(arg, "--min-silence") == 0) {
+      ok = parse_count(value, &number) && number >= 0 && number <= INT32_MAX;
+      options.min_silence_ms = (int)number;
+    } else if (strcmp(arg, "--min-speech") == 0) {
+      ok = parse_count(value, &number) && number >= 0 && number <= INT32_MAX;
+      options.min_speech_ms = (int)number;
+    } else if (strcmp(arg, "--speech-pad") == 0) {
+      ok = parse_count(value, &number) && number >= 0 && number <= INT32_MAX;
+      options.speech_pad_ms = (int)number;
+    } else if (strcmp(arg, "--threads") == 0) {
+      ok = parse_count(value, &number) && number > 0;
+      options.threads = (size_t)number;
+    } else if (strcmp(arg, "--batch") == 0) {
+      ok = parse_count(value, &number) && number > 0;
+      options.slots = (size_t)number;
+    } else {
+      ok = false;
+    }
+  }
+  if (!ok) {
+    usage(argv[0]);
+    path_list_free(&inputs);
+    return EXIT_FAILURE;
+  }
+
+  // Options alone (e.g. --model) still run the demo
+  if (inputs.size == 0U) {
+    path_list_free(&inputs);
+    return run_demo(&options);
+  }
+
+  if (!path_list_name_outputs(&inputs)) {
+    fprintf(stderr, "Out of memory\n");
+    path_list_free(&inputs);
+    return EXIT_FAILURE;
+  }
+
+  int status = EXIT_FAILURE;
+  vad_model_t *model = load_model(&options);
+  if (model == nullptr) {
+    fprintf(stderr, "Failed to initialize VAD\n");
+  } else if (options.threads > 0U) {
+    status = run_pool(&options, model, inputs.paths, inputs.stems,
+                      inputs.size);
+  } else {
+    status = run_corpus(&options, model, inputs.paths, inputs.stems,
+                        inputs.size);
+  }
+  vad_model_release(model);
+  path_list_free(&inputs);
+  return status;
+}
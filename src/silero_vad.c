@@ -1,20 +1,26 @@
 /*
     silero_vad.c - C23 Implementation of Silero VAD using ONNX Runtime C API
     Translated from silero-vad-onnx.cpp.
+    Models given as native weights run on vad_native.c instead; building with
+    SILERO_VAD_NO_ORT drops ONNX Runtime entirely.
 */
 
 #include <float.h>
 #include <math.h>
+#include <stdatomic.h>
 #include <stdckdint.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <threads.h>
+#include <unistd.h>
 
 #include "silero_vad.h"
 #include "wav.h"
 
+#ifndef SILERO_VAD_NO_ORT
 /* --- Platform Specifics for ONNX Runtime --- */
 typedef char ort_char_t;
 
@@ -40,9 +46,17 @@ static bool is_16k_model(const char *path) {
   }
   return strstr(path, "16k") != nullptr;
 }
+#endif
 
 /* --- Constants --- */
-// #define DEBUG_SPEECH_PROB
+
+constexpr unsigned int state_channels = 2U;
+constexpr unsigned int state_width = 128U;
+
+#ifndef SILERO_VAD_NO_ORT
+static const char *const input_names[] = {"input", "state", "sr"};
+static const char *const output_names[] = {"output", "stateN"};
+#endif
 
 static void vec_init(timestamp_vector_t *vec) {
   vec->data = nullptr;
@@ -74,6 +88,20 @@ static void vec_free(timestamp_vector_t *vec) {
 
 static void vec_clear(timestamp_vector_t *vec) { vec->size = 0; }
 
+// Move up to `capacity` entries off the front into out (nullptr drops them)
+static size_t vec_drain(timestamp_vector_t *vec, timestamp_t *out,
+                        size_t capacity) {
+  const size_t count = capacity < vec->size ? capacity : vec->size;
+  if (out != nullptr) {
+    memcpy(out, vec->data, count * sizeof(timestamp_t));
+  }
+  memmove(vec->data, vec->data + count,
+          (vec->size - count) * sizeof(timestamp_t));
+  vec->size -= count;
+  return count;
+}
+
+#ifndef SILERO_VAD_NO_ORT
 // Check ONNX Status helper
 static void check_status(const OrtApi *g_ort, OrtStatus *status) {
   if (status != nullptr) {
@@ -84,65 +112,90 @@ static void check_status(const OrtApi *g_ort, OrtStatus *status) {
   }
 }
 
+// Wrap caller-owned memory in a tensor; the buffer must outlive the value.
+[[nodiscard]]
+static OrtValue *create_tensor(const OrtApi *g_ort, const OrtMemoryInfo *info,
+                               void *data, size_t data_bytes,
+                               const int64_t *dims, size_t dims_count,
+                               ONNXTensorElementDataType type) {
+  OrtValue *value = nullptr;
+  check_status(g_ort,
+               g_ort->CreateTensorWithDataAsOrtValue(
+                   info, data, data_bytes, dims, dims_count, type, &value));
+  return value;
+}
+
+// Input (width = samples per window) or output (width = 1) shape for `rows`
+// streams stepping through `windows` windows; returns the rank. Only a scan
+// model takes more than one window per Run.
+static size_t window_dims(const vad_model_t *model, size_t windows,
+                          size_t rows, int64_t width, int64_t dims[3]) {
+  if (model->is_scan) {
+    dims[0] = (int64_t)windows;
+    dims[1] = (int64_t)rows;
+    dims[2] = width;
+    return 3U;
+  }
+  dims[0] = (int64_t)rows;
+  dims[1] = width;
+  return 2U;
+}
+#endif
+
 void vad_iterator_reset_states(vad_iterator_t *vad) {
-  if (vad == nullptr || vad->state == nullptr || vad->context == nullptr) {
+  if (vad == nullptr || vad->state == nullptr || vad->input_buffer == nullptr) {
     return;
   }
 
   memset(vad->state, 0, vad->size_state * sizeof(float));
-  memset(vad->context, 0, vad->context_samples * sizeof(float));
+  memset(vad->input_buffer, 0, vad->context_samples * sizeof(float));
 
   vad->triggered = false;
-  vad->temp_end = 0U;
-  vad->current_sample = 0U;
+  vad->temp_end = 0;
+  vad->current_sample = 0;
   vad->prev_end = 0;
   vad->next_start = 0;
+  vad->confident_run = 0;
+  vad->stride_skip = 0;
+  vad->held_prob = 0.0f;
+  vad->windows_gated = 0U;
+  vad->windows_strided = 0U;
+  vad->pending = 0U;
 
   vec_clear(&vad->speeches);
   vad->current_speech = (timestamp_t){-1, -1};
 }
 
 [[nodiscard]]
-bool vad_iterator_init(vad_iterator_t *vad, const char *model_path,
-                       int sample_rate, int window_frame_size_ms,
-                       float threshold, int min_silence_ms, int speech_pad_ms,
-                       int min_speech_ms, float max_speech_s) {
-  if (vad == nullptr || model_path == nullptr) {
-    return false;
-  }
-
-  memset(vad, 0, sizeof(*vad));
-
-  // 1. Setup API
-  vad->g_ort = OrtGetApiBase()->GetApi(ORT_API_VERSION);
-  if (vad->g_ort == nullptr) {
-    fprintf(stderr, "Failed to init ONNX Runtime API\n");
-    return false;
+static bool check_sample_rate(const vad_model_t *model, int sample_rate) {
+  if (model->native != nullptr) {
+    if (vad_native_net_for(model->native, sample_rate) == nullptr) {
+      fprintf(stderr, "Native weights carry no %d Hz graph\n", sample_rate);
+      return false;
+    }
+    return true;
   }
-
-  // 2. Constants & Sizes
-  const bool model_is_16k_only = is_16k_model(model_path);
-  if (model_is_16k_only && sample_rate != 16'000) {
-    fprintf(stderr, "Model at %s supports only 16'000 Hz\n", model_path);
+  if (model->is_16k_only && sample_rate != 16'000) {
+    fprintf(stderr, "Model supports only 16'000 Hz\n");
     return false;
   }
-  if (!model_is_16k_only && sample_rate != 16'000 && sample_rate != 8'000) {
+  if (!model->is_16k_only && sample_rate != 16'000 && sample_rate != 8'000) {
     fprintf(stderr, "Supported sample rates: 8'000 or 16'000 Hz (got %d)\n",
             sample_rate);
     return false;
   }
+  return true;
+}
 
-  const int context_samples = sample_rate == 16'000 ? 64 : 32;
-  constexpr unsigned int state_channels = 2U;
-  constexpr unsigned int state_batch = 1U;
-  constexpr unsigned int state_width = 128U;
-
+// Window size and the segmentation thresholds in samples, all that
+// vad_update and vad_finish read
+static void vad_segmentation_setup(vad_stream_t *vad, int sample_rate,
+                                   int window_frame_size_ms, float threshold,
+                                   int min_silence_ms, int speech_pad_ms,
+                                   int min_speech_ms, float max_speech_s) {
   vad->sample_rate = sample_rate;
   vad->sr_per_ms = sample_rate / 1'000;
   vad->window_size_samples = window_frame_size_ms * vad->sr_per_ms;
-  vad->context_samples = context_samples;
-  vad->effective_window_size = vad->window_size_samples + vad->context_samples;
-  vad->size_state = state_channels * state_batch * state_width;
 
   vad->threshold = threshold;
   vad->min_silence_samples = vad->sr_per_ms * min_silence_ms;
@@ -152,297 +205,2145 @@ bool vad_iterator_init(vad_iterator_t *vad, const char *model_path,
       (sample_rate * max_speech_s - vad->window_size_samples -
        2 * vad->speech_pad_samples);
   vad->min_silence_samples_at_max_speech = vad->sr_per_ms * 98;
+}
+
+// Sizes, thresholds and per-stream buffers; no ONNX Runtime resources.
+// `vad` must be zeroed. On failure everything allocated here is released.
+[[nodiscard]]
+static bool vad_stream_setup(vad_stream_t *vad, int sample_rate,
+                             int window_frame_size_ms, float threshold,
+                             int min_silence_ms, int speech_pad_ms,
+                             int min_speech_ms, float max_speech_s) {
+  const int context_samples = sample_rate == 16'000 ? 64 : 32;
+  constexpr unsigned int state_batch = 1U;
+
+  vad_segmentation_setup(vad, sample_rate, window_frame_size_ms, threshold,
+                         min_silence_ms, speech_pad_ms, min_speech_ms,
+                         max_speech_s);
+  vad->context_samples = context_samples;
+  vad->effective_window_size = vad->window_size_samples + vad->context_samples;
+  vad->size_state = state_channels * state_batch * state_width;
 
-  // 3. Allocate Buffers
-  vad->context = (float *)calloc((size_t)vad->context_samples, sizeof(float));
   vad->state = (float *)calloc((size_t)vad->size_state, sizeof(float));
   vad->sr_tensor_data = (int64_t *)calloc(1, sizeof(int64_t));
   vad->input_buffer =
       (float *)calloc((size_t)vad->effective_window_size, sizeof(float));
+  vad->output_buffer = (float *)calloc(1, sizeof(float));
+  vad->state_out = (float *)calloc((size_t)vad->size_state, sizeof(float));
   vec_init(&vad->speeches);
   vad->current_speech = (timestamp_t){-1, -1};
 
-  if (vad->context == nullptr || vad->state == nullptr ||
-      vad->sr_tensor_data == nullptr || vad->input_buffer == nullptr) {
-    vad_iterator_free(vad);
+  if (vad->state == nullptr || vad->sr_tensor_data == nullptr ||
+      vad->input_buffer == nullptr || vad->output_buffer == nullptr ||
+      vad->state_out == nullptr) {
+    vad_stream_free(vad);
     return false;
   }
 
   *vad->sr_tensor_data = sample_rate;
+  return true;
+}
 
-  // 4. Setup ONNX Env & Session
-  check_status(vad->g_ort, vad->g_ort->CreateEnv(ORT_LOGGING_LEVEL_WARNING,
-                                                 "SileroVAD", &vad->env));
-  check_status(vad->g_ort,
-               vad->g_ort->CreateSessionOptions(&vad->session_options));
+#ifndef SILERO_VAD_NO_ORT
+/* --- Process-wide Runtime --- */
 
-  constexpr int ort_thread_count = 1;
-  const auto g = vad->g_ort;
-  const auto opts = vad->session_options;
+// One OrtEnv per process, shared by every model. When global thread pools are
+// configured the env owns them and every session attaches to those pools.
+static struct {
+  once_flag once;
+  mtx_t lock;
+  OrtEnv *env;
+  size_t users; // live models, plus one while pools_hold_env
+  bool global_thread_pools;
+  bool pools_hold_env; // the reference of vad_global_thread_pool_init
+} runtime = {.once = ONCE_FLAG_INIT};
 
-  check_status(g, g->SetIntraOpNumThreads(opts, ort_thread_count));
-  check_status(g, g->SetInterOpNumThreads(opts, ort_thread_count));
-  check_status(g, g->SetSessionGraphOptimizationLevel(opts, ORT_ENABLE_ALL));
+static void runtime_init_lock(void) { mtx_init(&runtime.lock, mtx_plain); }
 
-  ort_char_t *ort_path = create_ort_path(model_path);
-  if (ort_path == nullptr) {
-    vad_iterator_free(vad);
-    return false;
+// Reference the shared env, creating it on first use
+[[nodiscard]]
+static OrtEnv *runtime_acquire(const OrtApi *g, bool *global_thread_pools) {
+  call_once(&runtime.once, runtime_init_lock);
+  mtx_lock(&runtime.lock);
+  if (runtime.env == nullptr) {
+    check_status(g,
+                 g->CreateEnv(ORT_LOGGING_LEVEL_WARNING, "SileroVAD",
+                              &runtime.env));
   }
+  runtime.users++;
+  *global_thread_pools = runtime.global_thread_pools;
+  const auto env = runtime.env;
+  mtx_unlock(&runtime.lock);
+  return env;
+}
 
-  check_status(vad->g_ort,
-               vad->g_ort->CreateSession(vad->env, ort_path,
-                                         vad->session_options, &vad->session));
-  free_ort_path(ort_path);
+// Drop one reference; runtime.lock must be held
+static void runtime_drop_locked(const OrtApi *g) {
+  if (runtime.users > 0U && --runtime.users == 0U) {
+    g->ReleaseEnv(runtime.env);
+    runtime.env = nullptr;
+    runtime.global_thread_pools = false;
+  }
+}
+
+static void runtime_release(const OrtApi *g) {
+  call_once(&runtime.once, runtime_init_lock);
+  mtx_lock(&runtime.lock);
+  runtime_drop_locked(g);
+  mtx_unlock(&runtime.lock);
+}
+
+[[nodiscard]]
+bool vad_global_thread_pool_init(int intra_op_threads, int inter_op_threads,
+                                 bool allow_spinning) {
+  const auto g = OrtGetApiBase()->GetApi(ORT_API_VERSION);
+  if (g == nullptr) {
+    fprintf(stderr, "Failed to init ONNX Runtime API\n");
+    return false;
+  }
 
-  check_status(vad->g_ort, vad->g_ort->CreateCpuMemoryInfo(OrtArenaAllocator,
-                                                           OrtMemTypeDefault,
-                                                           &vad->memory_info));
+  call_once(&runtime.once, runtime_init_lock);
+  mtx_lock(&runtime.lock);
+  if (runtime.env != nullptr) {
+    mtx_unlock(&runtime.lock);
+    fprintf(stderr, "Global thread pools must be configured before the first "
+                    "model is loaded\n");
+    return false;
+  }
 
+  OrtThreadingOptions *threading = nullptr;
+  check_status(g, g->CreateThreadingOptions(&threading));
+  check_status(g, g->SetGlobalIntraOpNumThreads(threading, intra_op_threads));
+  check_status(g, g->SetGlobalInterOpNumThreads(threading, inter_op_threads));
+  check_status(g, g->SetGlobalSpinControl(threading, allow_spinning ? 1 : 0));
+  check_status(g, g->CreateEnvWithGlobalThreadPools(ORT_LOGGING_LEVEL_WARNING,
+                                                    "SileroVAD", threading,
+                                                    &runtime.env));
+  g->ReleaseThreadingOptions(threading);
+
+  runtime.users = 1U;
+  runtime.global_thread_pools = true;
+  runtime.pools_hold_env = true;
+  mtx_unlock(&runtime.lock);
   return true;
 }
 
-void vad_iterator_free(vad_iterator_t *vad) {
-  if (vad == nullptr) {
+void vad_global_thread_pool_free(void) {
+  const auto g = OrtGetApiBase()->GetApi(ORT_API_VERSION);
+  if (g == nullptr) {
     return;
   }
+  // Only the call that clears the flag owns the pools' reference, so a
+  // second call, or a racing one, never drops a reference held by a model
+  call_once(&runtime.once, runtime_init_lock);
+  mtx_lock(&runtime.lock);
+  if (runtime.pools_hold_env) {
+    runtime.pools_hold_env = false;
+    runtime_drop_locked(g);
+  }
+  mtx_unlock(&runtime.lock);
+}
+#else
+[[nodiscard]]
+bool vad_global_thread_pool_init(int intra_op_threads, int inter_op_threads,
+                                 bool allow_spinning) {
+  (void)intra_op_threads;
+  (void)inter_op_threads;
+  (void)allow_spinning;
+  fprintf(stderr, "Built without ONNX Runtime: no thread pools to share\n");
+  return false;
+}
+
+void vad_global_thread_pool_free(void) {}
+#endif
+
+/* --- Model --- */
 
-  if (vad->g_ort != nullptr) {
-    if (vad->session != nullptr)
-      vad->g_ort->ReleaseSession(vad->session);
-    if (vad->session_options != nullptr)
-      vad->g_ort->ReleaseSessionOptions(vad->session_options);
-    if (vad->env != nullptr)
-      vad->g_ort->ReleaseEnv(vad->env);
-    if (vad->memory_info != nullptr)
-      vad->g_ort->ReleaseMemoryInfo(vad->memory_info);
-    vad->session = nullptr;
-    vad->session_options = nullptr;
-    vad->env = nullptr;
-    vad->memory_info = nullptr;
-    vad->g_ort = nullptr;
+void vad_config_init(vad_config_t *config) {
+  if (config == nullptr) {
+    return;
   }
+  // Matches the settings the library always used before they were tunable
+  *config = (vad_config_t){
+      .intra_op_threads = 1,
+      .inter_op_threads = 1,
+      .graph_optimization = VAD_GRAPH_OPT_ALL,
+      .parallel_execution = false,
+      .allow_intra_op_spinning = true,
+      .allow_inter_op_spinning = true,
+      .enable_cpu_mem_arena = true,
+      .enable_mem_pattern = true,
+      .cache_optimized_model = false,
+  };
+}
 
-  free(vad->context);
-  free(vad->state);
-  free(vad->sr_tensor_data);
-  free(vad->input_buffer);
-  vad->context = nullptr;
-  vad->state = nullptr;
-  vad->sr_tensor_data = nullptr;
-  vad->input_buffer = nullptr;
-  vec_free(&vad->speeches);
+// Wrap loaded native weights in a model; ORT handles stay null
+[[nodiscard]]
+static vad_model_t *vad_model_wrap_native(vad_native_model_t *native) {
+  if (native == nullptr) {
+    return nullptr;
+  }
+  // Streams size their state for the [2, 1, 128] LSTM of the ONNX model
+  for (size_t i = 0; i < native->net_count; i++) {
+    if (native->nets[i].hidden != state_width) {
+      fprintf(stderr, "Native weights have LSTM width %u, expected %u\n",
+              native->nets[i].hidden, state_width);
+      vad_native_free(native);
+      return nullptr;
+    }
+  }
+  auto model = (vad_model_t *)calloc(1, sizeof(vad_model_t));
+  if (model == nullptr) {
+    vad_native_free(native);
+    return nullptr;
+  }
+  model->native = native;
+  model->is_16k_only = vad_native_net_for(native, 8'000) == nullptr;
+  atomic_init(&model->refcount, 1U);
+  return model;
 }
 
-// Core inference logic
-static void vad_predict(vad_iterator_t *vad, const float *data_chunk) {
-  if (vad == nullptr || data_chunk == nullptr) {
-    return;
+#ifndef SILERO_VAD_NO_ORT
+static GraphOptimizationLevel ort_graph_level(vad_graph_opt_t level) {
+  switch (level) {
+  case VAD_GRAPH_OPT_DISABLE:
+    return ORT_DISABLE_ALL;
+  case VAD_GRAPH_OPT_BASIC:
+    return ORT_ENABLE_BASIC;
+  case VAD_GRAPH_OPT_EXTENDED:
+    return ORT_ENABLE_EXTENDED;
+  case VAD_GRAPH_OPT_ALL:
+    break;
   }
+  return ORT_ENABLE_ALL;
+}
 
-  const auto g = vad->g_ort;
-  if (g == nullptr || vad->memory_info == nullptr || vad->session == nullptr) {
-    return;
+// API, env and session options; the caller creates the session.
+[[nodiscard]]
+static vad_model_t *vad_model_create(const char *model_path,
+                                     const vad_config_t *config) {
+  const auto g = OrtGetApiBase()->GetApi(ORT_API_VERSION);
+  if (g == nullptr) {
+    fprintf(stderr, "Failed to init ONNX Runtime API\n");
+    return nullptr;
   }
 
-  // 1. Prepare Input Buffer: [Context (64)] + [Chunk (WindowSize)]
-  memcpy(vad->input_buffer, vad->context, vad->context_samples * sizeof(float));
-  memcpy(vad->input_buffer + vad->context_samples, data_chunk,
-         vad->window_size_samples * sizeof(float));
+  auto model = (vad_model_t *)calloc(1, sizeof(vad_model_t));
+  if (model == nullptr) {
+    return nullptr;
+  }
+  model->g_ort = g;
+  model->is_16k_only = is_16k_model(model_path);
+  atomic_init(&model->refcount, 1U);
+
+  bool global_thread_pools = false;
+  model->env = runtime_acquire(g, &global_thread_pools);
+  check_status(g, g->CreateSessionOptions(&model->session_options));
+
+  const auto opts = model->session_options;
+
+  // Sessions on global pools own no threads, so thread counts do not apply
+  if (global_thread_pools) {
+    check_status(g, g->DisablePerSessionThreads(opts));
+  } else {
+    check_status(g, g->SetIntraOpNumThreads(opts, config->intra_op_threads));
+    check_status(g, g->SetInterOpNumThreads(opts, config->inter_op_threads));
+  }
+  check_status(g, g->SetSessionGraphOptimizationLevel(
+                      opts, ort_graph_level(config->graph_optimization)));
+  check_status(g, g->SetSessionExecutionMode(
+                      opts, config->parallel_execution ? ORT_PARALLEL
+                                                       : ORT_SEQUENTIAL));
+  check_status(g, g->AddSessionConfigEntry(
+                      opts, "session.intra_op.allow_spinning",
+                      config->allow_intra_op_spinning ? "1" : "0"));
+  check_status(g, g->AddSessionConfigEntry(
+                      opts, "session.inter_op.allow_spinning",
+                      config->allow_inter_op_spinning ? "1" : "0"));
+  if (!config->enable_cpu_mem_arena) {
+    check_status(g, g->DisableCpuMemArena(opts));
+  }
+  if (!config->enable_mem_pattern) {
+    check_status(g, g->DisableMemPattern(opts));
+  }
 
-  // 2. Create Tensors
-  OrtValue *input_ort = nullptr;
-  int64_t input_dims[] = {1, vad->effective_window_size};
-  check_status(g, g->CreateTensorWithDataAsOrtValue(
-                      vad->memory_info, vad->input_buffer,
-                      vad->effective_window_size * sizeof(float), input_dims, 2,
-                      ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT, &input_ort));
-
-  OrtValue *state_ort = nullptr;
-  int64_t state_dims[] = {2, 1, 128};
-  check_status(g, g->CreateTensorWithDataAsOrtValue(
-                      vad->memory_info, vad->state,
-                      vad->size_state * sizeof(float), state_dims, 3,
-                      ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT, &state_ort));
-
-  OrtValue *sr_ort = nullptr;
-  int64_t sr_dims[] = {1};
-  check_status(g,
-               g->CreateTensorWithDataAsOrtValue(
-                   vad->memory_info, vad->sr_tensor_data, sizeof(int64_t),
-                   sr_dims, 1, ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64, &sr_ort));
+  check_status(g, g->CreateCpuMemoryInfo(OrtArenaAllocator, OrtMemTypeDefault,
+                                         &model->memory_info));
+  return model;
+}
 
-  // 3. Run Inference
-  const char *input_names[] = {"input", "state", "sr"};
-  const char *output_names[] = {"output", "stateN"};
-  const OrtValue *inputs[] = {input_ort, state_ort, sr_ort};
-  OrtValue *outputs[] = {nullptr, nullptr};
+// Create the session from a file. Errors are returned, not fatal, so cache
+// misses can fall back to the source model.
+[[nodiscard]]
+static OrtStatus *vad_model_open(vad_model_t *model, const char *path) {
+  const auto g = model->g_ort;
+  ort_char_t *ort_path = create_ort_path(path);
+  if (ort_path == nullptr) {
+    return g->CreateStatus(ORT_FAIL, "out of memory");
+  }
+  auto status = g->CreateSession(model->env, ort_path, model->session_options,
+                                 &model->session);
+  free_ort_path(ort_path);
+  return status;
+}
 
-  check_status(g, g->Run(vad->session, nullptr, input_names, inputs, 3,
-                         output_names, 2, outputs));
+// Scan-wrapped models (tools/wrap_scan.py) have a rank-3 "input"
+[[nodiscard]]
+static bool vad_session_is_scan(const vad_model_t *model) {
+  const auto g = model->g_ort;
+  OrtAllocator *allocator = nullptr;
+  check_status(g, g->GetAllocatorWithDefaultOptions(&allocator));
+
+  size_t count = 0;
+  check_status(g, g->SessionGetInputCount(model->session, &count));
+  for (size_t i = 0; i < count; i++) {
+    char *name = nullptr;
+    check_status(g,
+                 g->SessionGetInputName(model->session, i, allocator, &name));
+    const bool is_input = strcmp(name, "input") == 0;
+    check_status(g, g->AllocatorFree(allocator, name));
+    if (!is_input) {
+      continue;
+    }
 
-  // 4. Get Outputs
-  float *output_data = nullptr;
-  check_status(g, g->GetTensorMutableData(outputs[0], (void **)&output_data));
-  const auto speech_prob = output_data[0];
+    OrtTypeInfo *type_info = nullptr;
+    const OrtTensorTypeAndShapeInfo *tensor_info = nullptr;
+    size_t rank = 0;
+    check_status(g, g->SessionGetInputTypeInfo(model->session, i, &type_info));
+    check_status(g, g->CastTypeInfoToTensorInfo(type_info, &tensor_info));
+    check_status(g, g->GetDimensionsCount(tensor_info, &rank));
+    g->ReleaseTypeInfo(type_info);
+    return rank == 3U;
+  }
+  return false;
+}
 
-  float *stateN_data = nullptr;
-  check_status(g, g->GetTensorMutableData(outputs[1], (void **)&stateN_data));
+// tools/quantize_model.py tags its int8 QDQ graphs in the model metadata
+[[nodiscard]]
+static bool vad_session_is_quantized(const vad_model_t *model) {
+  const auto g = model->g_ort;
+  OrtAllocator *allocator = nullptr;
+  OrtModelMetadata *metadata = nullptr;
+  char *value = nullptr;
+  check_status(g, g->GetAllocatorWithDefaultOptions(&allocator));
+  check_status(g, g->SessionGetModelMetadata(model->session, &metadata));
+  check_status(g, g->ModelMetadataLookupCustomMetadataMap(
+                      metadata, allocator, "quantization", &value));
+  g->ReleaseModelMetadata(metadata);
+  if (value == nullptr) {
+    return false;
+  }
+  const bool quantized = strcmp(value, "int8-qdq") == 0;
+  check_status(g, g->AllocatorFree(allocator, value));
+  return quantized;
+}
 
-  // Update state for next step
-  memcpy(vad->state, stateN_data, vad->size_state * sizeof(float));
+// What kind of graph the new session runs
+static void vad_model_inspect(vad_model_t *model, const vad_config_t *config) {
+  model->is_scan = vad_session_is_scan(model);
+  model->is_quantized = vad_session_is_quantized(model);
+
+  // ORT fuses Q/DQ pairs into int8 kernels from the extended level on; below
+  // it the quantized graph runs in float, slower than the original model.
+  if (model->is_quantized &&
+      config->graph_optimization < VAD_GRAPH_OPT_EXTENDED) {
+    fprintf(stderr, "int8 model loaded without extended graph optimization: "
+                    "its Q/DQ pairs will not be fused\n");
+  }
+}
+#endif
 
-  // Cleanup Tensors (wrappers only, data is owned by struct)
-  g->ReleaseValue(input_ort);
-  g->ReleaseValue(state_ort);
-  g->ReleaseValue(sr_ort);
-  g->ReleaseValue(outputs[0]);
-  g->ReleaseValue(outputs[1]);
+[[nodiscard]]
+vad_model_t *vad_model_load_from_memory(const void *model_data,
+                                        size_t model_size,
+                                        const vad_config_t *config) {
+  if (model_data == nullptr || model_size == 0U) {
+    return nullptr;
+  }
+  if (vad_native_probe(model_data, model_size)) {
+    return vad_model_wrap_native(vad_native_load(model_data, model_size));
+  }
 
-  // 5. Logic
-  vad->current_sample += (unsigned int)vad->window_size_samples;
+#ifdef SILERO_VAD_NO_ORT
+  (void)config;
+  fprintf(stderr, "Built without ONNX Runtime: expected native weights\n");
+  return nullptr;
+#else
+  vad_config_t defaults;
+  if (config == nullptr) {
+    vad_config_init(&defaults);
+    config = &defaults;
+  }
 
-  if (speech_prob >= vad->threshold) {
-#ifdef DEBUG_SPEECH_PROB
-    float speech = (float)vad->current_sample - vad->window_size_samples;
-    printf("{ start: %.3f s (%.3f) %08d}\n", speech / vad->sample_rate,
-           speech_prob, vad->current_sample - vad->window_size_samples);
+  auto model = vad_model_create(nullptr, config);
+  if (model == nullptr) {
+    return nullptr;
+  }
+  const auto g = model->g_ort;
+  check_status(g, g->CreateSessionFromArray(model->env, model_data, model_size,
+                                            model->session_options,
+                                            &model->session));
+  vad_model_inspect(model, config);
+  return model;
 #endif
-    if (vad->temp_end != 0) {
-      vad->temp_end = 0;
-      if (vad->next_start < vad->prev_end)
-        vad->next_start = vad->current_sample - vad->window_size_samples;
-    }
-    if (!vad->triggered) {
-      vad->triggered = true;
-      vad->current_speech.start =
-          vad->current_sample - vad->window_size_samples;
-    }
+}
 
-    // Update context: Last 64 samples of current buffer
-    memcpy(vad->context,
-           vad->input_buffer +
-               (vad->effective_window_size - vad->context_samples),
-           vad->context_samples * sizeof(float));
-    return;
+#ifndef SILERO_VAD_NO_ORT
+/* --- Optimized Model Cache --- */
+
+static uint64_t fnv1a(uint64_t h, const void *data, size_t size) {
+  constexpr uint64_t fnv_prime = 1'099'511'628'211ULL;
+  const unsigned char *bytes = data;
+  for (size_t i = 0; i < size; i++) {
+    h = (h ^ bytes[i]) * fnv_prime;
   }
+  return h;
+}
 
-  if (vad->triggered &&
-      ((int)(vad->current_sample - vad->current_speech.start) >
-       vad->max_speech_samples)) {
-    if (vad->prev_end > 0) {
-      vad->current_speech.end = vad->prev_end;
-      vec_push(&vad->speeches, vad->current_speech);
+// FNV-1a over the model bytes, the runtime version and the session options
+// that shape the optimized graph: a new model, a new ONNX Runtime or another
+// optimization level, execution mode or thread count all miss the cache.
+// Sessions always run on the CPU provider, so it needs no key of its own.
+[[nodiscard]]
+static bool hash_model_file(const char *path, const vad_config_t *config,
+                            uint64_t *hash) {
+  constexpr uint64_t fnv_offset = 14'695'981'039'346'656'037ULL;
 
-      vad->current_speech = (timestamp_t){-1, -1};
-      if (vad->next_start < vad->prev_end)
-        vad->triggered = false;
-      else
-        vad->current_speech.start = vad->next_start;
+  FILE *fp = fopen(path, "rb");
+  if (fp == nullptr) {
+    return false;
+  }
 
-      vad->prev_end = 0;
-      vad->next_start = 0;
-      vad->temp_end = 0;
-    } else {
-      vad->current_speech.end = vad->current_sample;
-      vec_push(&vad->speeches, vad->current_speech);
-      vad->current_speech = (timestamp_t){-1, -1};
-      vad->prev_end = 0;
-      vad->next_start = 0;
-      vad->temp_end = 0;
-      vad->triggered = false;
+  uint64_t h = fnv_offset;
+  unsigned char buffer[64 * 1'024];
+  size_t n = 0;
+  while ((n = fread(buffer, 1, sizeof(buffer), fp)) > 0U) {
+    h = fnv1a(h, buffer, n);
+  }
+  const bool ok = ferror(fp) == 0;
+  fclose(fp);
+
+  const char *version = OrtGetApiBase()->GetVersionString();
+  h = fnv1a(h, version, strlen(version));
+
+  const int32_t options[] = {
+      (int32_t)config->graph_optimization,
+      config->parallel_execution ? 1 : 0,
+      config->intra_op_threads,
+      config->inter_op_threads,
+  };
+  h = fnv1a(h, options, sizeof(options));
+
+  *hash = h;
+  return ok;
+}
+
+// "dir/silero_vad.onnx" -> "dir/silero_vad.<hash>.opt.onnx"
+[[nodiscard]]
+static char *cache_path_for(const char *model_path, uint64_t hash) {
+  size_t stem = strlen(model_path);
+  constexpr char suffix[] = ".onnx";
+  constexpr size_t suffix_len = sizeof(suffix) - 1U;
+  if (stem >= suffix_len &&
+      strcmp(model_path + stem - suffix_len, suffix) == 0) {
+    stem -= suffix_len;
+  }
+
+  const int len = snprintf(nullptr, 0, "%.*s.%016llx.opt.onnx", (int)stem,
+                           model_path, (unsigned long long)hash);
+  if (len < 0) {
+    return nullptr;
+  }
+  auto path = (char *)malloc((size_t)len + 1U);
+  if (path == nullptr) {
+    return nullptr;
+  }
+  snprintf(path, (size_t)len + 1U, "%.*s.%016llx.opt.onnx", (int)stem,
+           model_path, (unsigned long long)hash);
+  return path;
+}
+
+static bool file_exists(const char *path) {
+  FILE *fp = fopen(path, "rb");
+  if (fp == nullptr) {
+    return false;
+  }
+  fclose(fp);
+  return true;
+}
+
+// Keep the ORT-optimized graph next to the model and load it without
+// re-running graph optimization on later calls. Returns nullptr without side
+// effects when the cache cannot be read or written, so the caller loads
+// normally.
+[[nodiscard]]
+static vad_model_t *vad_model_load_cached(const char *model_path,
+                                          const vad_config_t *config) {
+  uint64_t hash = 0;
+  if (!hash_model_file(model_path, config, &hash)) {
+    return nullptr;
+  }
+  char *cache_path = cache_path_for(model_path, hash);
+  if (cache_path == nullptr) {
+    return nullptr;
+  }
+
+  auto model = vad_model_create(model_path, config);
+  if (model == nullptr) {
+    free(cache_path);
+    return nullptr;
+  }
+  const auto g = model->g_ort;
+  const auto opts = model->session_options;
+
+  // 1. Hit: the graph is already optimized, skip the optimizer entirely
+  if (file_exists(cache_path)) {
+    check_status(g, g->SetSessionGraphOptimizationLevel(opts, ORT_DISABLE_ALL));
+    auto status = vad_model_open(model, cache_path);
+    if (status == nullptr) {
+      free(cache_path);
+      return model;
     }
-    memcpy(vad->context,
-           vad->input_buffer +
-               (vad->effective_window_size - vad->context_samples),
-           vad->context_samples * sizeof(float));
-    return;
+    fprintf(stderr, "Discarding unreadable model cache %s: %s\n", cache_path,
+            g->GetErrorMessage(status));
+    g->ReleaseStatus(status);
+    remove(cache_path);
+    check_status(g, g->SetSessionGraphOptimizationLevel(
+                        opts, ort_graph_level(config->graph_optimization)));
   }
 
-  if ((speech_prob >= (vad->threshold - 0.15f)) &&
-      (speech_prob < vad->threshold)) {
-    memcpy(vad->context,
-           vad->input_buffer +
-               (vad->effective_window_size - vad->context_samples),
-           vad->context_samples * sizeof(float));
-    return;
+  // 2. Miss: optimize the source model and let ORT save the result. Write to
+  // a private name and rename, so concurrent workers never see a partial file.
+  // The pid keeps the name private across processes, the address within one.
+  char *temp_path = nullptr;
+  const long pid = (long)getpid();
+  const int len =
+      snprintf(nullptr, 0, "%s.%ld.%p.tmp", cache_path, pid, (void *)model);
+  if (len > 0) {
+    temp_path = (char *)malloc((size_t)len + 1U);
+  }
+  if (temp_path != nullptr) {
+    snprintf(temp_path, (size_t)len + 1U, "%s.%ld.%p.tmp", cache_path, pid,
+             (void *)model);
+    check_status(g, g->SetOptimizedModelFilePath(opts, temp_path));
   }
 
-  if (speech_prob < (vad->threshold - 0.15f)) {
-#ifdef DEBUG_SPEECH_PROB
-    float speech = (float)vad->current_sample - vad->window_size_samples -
-                   vad->speech_pad_samples;
-    printf("{ end: %.3f s (%.3f) %08d}\n", speech / vad->sample_rate,
-           speech_prob, vad->current_sample - vad->window_size_samples);
+  // A read-only model directory fails the save; load without the cache then
+  auto status = vad_model_open(model, model_path);
+  if (status != nullptr) {
+    fprintf(stderr, "Cannot write model cache %s: %s\n", cache_path,
+            g->GetErrorMessage(status));
+    g->ReleaseStatus(status);
+    if (temp_path != nullptr) {
+      remove(temp_path);
+    }
+    vad_model_release(model);
+    free(temp_path);
+    free(cache_path);
+    return nullptr;
+  }
+
+  if (temp_path != nullptr && rename(temp_path, cache_path) != 0) {
+    remove(temp_path);
+  }
+  free(temp_path);
+  free(cache_path);
+  return model;
+}
 #endif
-    if (vad->triggered) {
-      if (vad->temp_end == 0)
-        vad->temp_end = vad->current_sample;
 
-      if ((int)(vad->current_sample - vad->temp_end) >
-          vad->min_silence_samples_at_max_speech)
-        vad->prev_end = vad->temp_end;
+[[nodiscard]]
+vad_model_t *vad_model_load(const char *model_path,
+                            const vad_config_t *config) {
+  if (model_path == nullptr) {
+    return nullptr;
+  }
+  if (vad_native_probe_file(model_path)) {
+    return vad_model_wrap_native(vad_native_load_file(model_path));
+  }
 
-      if ((int)(vad->current_sample - vad->temp_end) >=
-          vad->min_silence_samples) {
-        vad->current_speech.end = vad->temp_end;
-        if ((vad->current_speech.end - vad->current_speech.start) >
-            vad->min_speech_samples) {
-          vec_push(&vad->speeches, vad->current_speech);
-          vad->current_speech = (timestamp_t){-1, -1};
-          vad->prev_end = 0;
-          vad->next_start = 0;
-          vad->temp_end = 0;
-          vad->triggered = false;
-        }
-      }
+#ifdef SILERO_VAD_NO_ORT
+  (void)config;
+  fprintf(stderr, "Built without ONNX Runtime: %s is not native weights\n",
+          model_path);
+  return nullptr;
+#else
+  vad_config_t defaults;
+  if (config == nullptr) {
+    vad_config_init(&defaults);
+    config = &defaults;
+  }
+
+  // An unoptimized graph has nothing worth caching
+  if (config->cache_optimized_model &&
+      config->graph_optimization != VAD_GRAPH_OPT_DISABLE) {
+    auto model = vad_model_load_cached(model_path, config);
+    if (model != nullptr) {
+      vad_model_inspect(model, config);
+      return model;
     }
-    memcpy(vad->context,
-           vad->input_buffer +
-               (vad->effective_window_size - vad->context_samples),
-           vad->context_samples * sizeof(float));
-    return;
   }
+
+  auto model = vad_model_create(model_path, config);
+  if (model == nullptr) {
+    return nullptr;
+  }
+  check_status(model->g_ort, vad_model_open(model, model_path));
+  vad_model_inspect(model, config);
+  return model;
+#endif
 }
 
-void vad_iterator_process(vad_iterator_t *vad, const float *input_wav,
-                          size_t audio_length_samples) {
-  if (vad == nullptr || input_wav == nullptr) {
-    return;
+vad_model_t *vad_model_retain(vad_model_t *model) {
+  if (model != nullptr) {
+    atomic_fetch_add_explicit(&model->refcount, 1U, memory_order_relaxed);
   }
+  return model;
+}
 
-  if (vad->window_size_samples == 0) {
+void vad_model_release(vad_model_t *model) {
+  if (model == nullptr) {
+    return;
+  }
+  if (atomic_fetch_sub_explicit(&model->refcount, 1U, memory_order_acq_rel) !=
+      1U) {
     return;
   }
 
-  vad_iterator_reset_states(vad);
+  vad_native_free(model->native);
+#ifndef SILERO_VAD_NO_ORT
+  const auto g = model->g_ort;
+  if (model->session != nullptr)
+    g->ReleaseSession(model->session);
+  if (model->session_options != nullptr)
+    g->ReleaseSessionOptions(model->session_options);
+  if (model->env != nullptr)
+    runtime_release(g);
+  if (model->memory_info != nullptr)
+    g->ReleaseMemoryInfo(model->memory_info);
+#endif
+  free(model);
+}
 
-  const size_t chunk = (size_t)vad->window_size_samples;
+/* --- Streams --- */
 
-  size_t j = 0;
-  for (; j + chunk <= audio_length_samples; j += chunk) {
-    vad_predict(vad, &input_wav[j]);
+[[nodiscard]]
+bool vad_stream_init(vad_stream_t *stream, vad_model_t *model,
+                     int sample_rate, int window_frame_size_ms,
+                     float threshold, int min_silence_ms, int speech_pad_ms,
+                     int min_speech_ms, float max_speech_s) {
+  if (stream == nullptr || model == nullptr) {
+    return false;
   }
 
-  const size_t remaining = audio_length_samples - j;
-  if (remaining > 0U) {
-    auto padded = (float *)calloc(chunk, sizeof(float));
-    if (padded == nullptr) {
-      fprintf(stderr, "OOM while padding audio chunk\n");
-      return;
-    }
-    memcpy(padded, &input_wav[j], remaining * sizeof(float));
-    vad_predict(vad, padded);
-    free(padded);
+  memset(stream, 0, sizeof(*stream));
+
+  // 1. Constants, Sizes & Buffers
+  if (!check_sample_rate(model, sample_rate)) {
+    return false;
+  }
+  if (!vad_stream_setup(stream, sample_rate, window_frame_size_ms,
+                          threshold, min_silence_ms, speech_pad_ms,
+                          min_speech_ms, max_speech_s)) {
+    return false;
   }
 
-  if (vad->current_speech.start >= 0) {
-    vad->current_speech.end = (int)audio_length_samples;
-    vec_push(&vad->speeches, vad->current_speech);
-    vad->current_speech = (timestamp_t){-1, -1};
-    vad->prev_end = 0;
-    vad->next_start = 0;
-    vad->temp_end = 0;
-    vad->triggered = false;
+  stream->model = vad_model_retain(model);
+  const auto vad = stream;
+
+  // Native weights: the engine reads the buffers directly, nothing to bind
+  if (model->native != nullptr) {
+    vad->native_net = vad_native_net_for(model->native, sample_rate);
+    if (!vad_native_supports(vad->native_net,
+                             (size_t)vad->effective_window_size)) {
+      fprintf(stderr, "Native engine does not support %d ms windows\n",
+              window_frame_size_ms);
+      vad_stream_free(vad);
+      return false;
+    }
+    return true;
   }
+
+#ifndef SILERO_VAD_NO_ORT
+  const auto g = model->g_ort;
+
+  // 2. Wrap the persistent buffers once and bind them, so a window only has
+  // to fill input_buffer and call RunWithBinding.
+  int64_t input_dims[3];
+  int64_t output_dims[3];
+  const size_t input_rank =
+      window_dims(model, 1U, 1U, vad->effective_window_size, input_dims);
+  const size_t output_rank = window_dims(model, 1U, 1U, 1, output_dims);
+  const int64_t state_dims[] = {state_channels, 1, state_width};
+  const int64_t sr_dims[] = {1};
+
+  vad->input_ort = create_tensor(
+      g, model->memory_info, vad->input_buffer,
+      (size_t)vad->effective_window_size * sizeof(float), input_dims,
+      input_rank, ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT);
+  vad->state_ort = create_tensor(
+      g, model->memory_info, vad->state, vad->size_state * sizeof(float),
+      state_dims, 3, ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT);
+  vad->sr_ort =
+      create_tensor(g, model->memory_info, vad->sr_tensor_data, sizeof(int64_t),
+                    sr_dims, 1, ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64);
+  vad->output_ort = create_tensor(g, model->memory_info, vad->output_buffer,
+                                  sizeof(float), output_dims, output_rank,
+                                  ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT);
+  vad->state_out_ort = create_tensor(
+      g, model->memory_info, vad->state_out, vad->size_state * sizeof(float),
+      state_dims, 3, ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT);
+
+  check_status(g, g->CreateIoBinding(model->session, &vad->binding));
+  check_status(g, g->BindInput(vad->binding, "input", vad->input_ort));
+  check_status(g, g->BindInput(vad->binding, "state", vad->state_ort));
+  check_status(g, g->BindInput(vad->binding, "sr", vad->sr_ort));
+  check_status(g, g->BindOutput(vad->binding, "output", vad->output_ort));
+  check_status(g, g->BindOutput(vad->binding, "stateN", vad->state_out_ort));
+
+  check_status(g, g->CreateIoBinding(model->session, &vad->next_binding));
+  check_status(g, g->BindInput(vad->next_binding, "input", vad->input_ort));
+  check_status(g, g->BindInput(vad->next_binding, "state", vad->state_out_ort));
+  check_status(g, g->BindInput(vad->next_binding, "sr", vad->sr_ort));
+  check_status(g, g->BindOutput(vad->next_binding, "output", vad->output_ort));
+  check_status(g, g->BindOutput(vad->next_binding, "stateN", vad->state_ort));
+#endif
+
+  return true;
+}
+
+[[nodiscard]]
+bool vad_iterator_init(vad_iterator_t *vad, const char *model_path,
+                       int sample_rate, int window_frame_size_ms,
+                       float threshold, int min_silence_ms, int speech_pad_ms,
+                       int min_speech_ms, float max_speech_s) {
+  if (vad == nullptr || model_path == nullptr) {
+    return false;
+  }
+
+  // The stream keeps the only reference, so the model goes with it
+  auto model = vad_model_load(model_path, nullptr);
+  if (model == nullptr) {
+    memset(vad, 0, sizeof(*vad));
+    return false;
+  }
+  const bool ok = vad_stream_init(vad, model, sample_rate,
+                                  window_frame_size_ms, threshold,
+                                  min_silence_ms, speech_pad_ms,
+                                  min_speech_ms, max_speech_s);
+  vad_model_release(model);
+  return ok;
+}
+
+void vad_stream_free(vad_stream_t *stream) {
+  if (stream == nullptr) {
+    return;
+  }
+
+  const auto vad = stream;
+#ifndef SILERO_VAD_NO_ORT
+  if (vad->model != nullptr && vad->model->g_ort != nullptr) {
+    const auto g = vad->model->g_ort;
+    if (vad->binding != nullptr)
+      g->ReleaseIoBinding(vad->binding);
+    if (vad->next_binding != nullptr)
+      g->ReleaseIoBinding(vad->next_binding);
+    g->ReleaseValue(vad->input_ort);
+    g->ReleaseValue(vad->state_ort);
+    g->ReleaseValue(vad->sr_ort);
+    g->ReleaseValue(vad->output_ort);
+    g->ReleaseValue(vad->state_out_ort);
+    vad->binding = nullptr;
+    vad->next_binding = nullptr;
+    vad->input_ort = nullptr;
+    vad->state_ort = nullptr;
+    vad->sr_ort = nullptr;
+    vad->output_ort = nullptr;
+    vad->state_out_ort = nullptr;
+  }
+#endif
+  if (vad->model != nullptr) {
+    vad_model_release(vad->model);
+    vad->model = nullptr;
+  }
+  vad->native_net = nullptr;
+
+  free(vad->state);
+  free(vad->sr_tensor_data);
+  free(vad->input_buffer);
+  free(vad->output_buffer);
+  free(vad->state_out);
+  vad->state = nullptr;
+  vad->sr_tensor_data = nullptr;
+  vad->input_buffer = nullptr;
+  vad->output_buffer = nullptr;
+  vad->state_out = nullptr;
+  free(vad->block_scratch);
+  vad->block_scratch = nullptr;
+  vad->block_scratch_size = 0U;
+  vec_free(&vad->speeches);
+}
+
+void vad_iterator_free(vad_iterator_t *vad) { vad_stream_free(vad); }
+
+void vad_stream_set_energy_gate(vad_stream_t *stream, float rms_dbfs,
+                                float peak_dbfs) {
+  if (stream == nullptr) {
+    return;
+  }
+  const float rms = powf(10.0f, rms_dbfs / 20.0f);
+  stream->gate_energy = (float)stream->window_size_samples * rms * rms;
+  stream->gate_peak = powf(10.0f, peak_dbfs / 20.0f);
+}
+
+void vad_stream_set_event_callback(vad_stream_t *stream,
+                                   vad_event_callback_t callback,
+                                   void *user_data) {
+  if (stream == nullptr) {
+    return;
+  }
+  stream->on_event = callback;
+  stream->event_user_data = user_data;
+}
+
+void vad_stream_set_prob_callback(vad_stream_t *stream,
+                                  vad_prob_callback_t callback,
+                                  void *user_data) {
+  if (stream == nullptr) {
+    return;
+  }
+  stream->on_prob = callback;
+  stream->prob_user_data = user_data;
+}
+
+size_t vad_stream_window_count(const vad_stream_t *stream, size_t n_samples) {
+  if (stream == nullptr || stream->window_size_samples <= 0) {
+    return 0U;
+  }
+  const size_t chunk = (size_t)stream->window_size_samples;
+  return (n_samples + chunk - 1U) / chunk;
+}
+
+size_t vad_stream_drain(vad_stream_t *stream, timestamp_t *out,
+                        size_t capacity) {
+  if (stream == nullptr) {
+    return 0U;
+  }
+  return vec_drain(&stream->speeches, out, capacity);
+}
+
+void vad_stream_set_epoch(vad_stream_t *stream, int64_t first_sample) {
+  if (stream != nullptr) {
+    stream->epoch = first_sample;
+  }
+}
+
+void vad_stream_set_adaptive_stride(vad_stream_t *stream,
+                                    int confident_windows, int stride) {
+  if (stream == nullptr) {
+    return;
+  }
+  const bool on = stride > 1 && confident_windows > 0;
+  stream->stride_after = on ? confident_windows : 0;
+  stream->stride = on ? stride : 0;
+  stream->confident_run = 0;
+  stream->stride_skip = 0;
+}
+
+static void swap_state_buffers(vad_stream_t *vad) {
+  const auto state = vad->state;
+  vad->state = vad->state_out;
+  vad->state_out = state;
+
+  const auto state_ort = vad->state_ort;
+  vad->state_ort = vad->state_out_ort;
+  vad->state_out_ort = state_ort;
+
+  const auto binding = vad->binding;
+  vad->binding = vad->next_binding;
+  vad->next_binding = binding;
+}
+
+static void vad_emit(vad_stream_t *vad, vad_event_type_t type) {
+  if (vad->on_event != nullptr) {
+    vad_event_t event = {.type = type, .speech = vad->current_speech};
+    event.speech.start += vad->epoch;
+    event.speech.end =
+        type == VAD_SPEECH_START ? -1 : event.speech.end + vad->epoch;
+    vad->on_event(&event, vad->event_user_data);
+  }
+}
+
+// Store the segment just closed and report its end
+static void vad_push_speech(vad_stream_t *vad) {
+  vec_push(&vad->speeches,
+           (timestamp_t){vad->current_speech.start + vad->epoch,
+                         vad->current_speech.end + vad->epoch});
+  vad_emit(vad, VAD_SPEECH_END);
+}
+
+// Segmentation state machine, fed with one window probability at a time
+static void vad_update(vad_stream_t *vad, float speech_prob) {
+  vad->current_sample += vad->window_size_samples;
+
+  if (vad->prob_log != nullptr) {
+    vad->prob_log[vad->current_sample / vad->window_size_samples - 1] =
+        speech_prob;
+    return;
+  }
+
+  if (vad->on_prob != nullptr) {
+    vad->on_prob(vad->current_sample - vad->window_size_samples + vad->epoch,
+                 speech_prob, vad->prob_user_data);
+  }
+
+  if (speech_prob >= vad->threshold) {
+    if (vad->temp_end != 0) {
+      vad->temp_end = 0;
+      if (vad->next_start < vad->prev_end)
+        vad->next_start = vad->current_sample - vad->window_size_samples;
+    }
+    if (!vad->triggered) {
+      vad->triggered = true;
+      vad->current_speech.start =
+          vad->current_sample - vad->window_size_samples;
+      vad_emit(vad, VAD_SPEECH_START);
+    }
+    return;
+  }
+
+  if (vad->triggered &&
+      ((double)(vad->current_sample - vad->current_speech.start) >
+       vad->max_speech_samples)) {
+    if (vad->prev_end > 0) {
+      vad->current_speech.end = vad->prev_end;
+      vad_push_speech(vad);
+
+      vad->current_speech = (timestamp_t){-1, -1};
+      if (vad->next_start < vad->prev_end) {
+        vad->triggered = false;
+      } else {
+        vad->current_speech.start = vad->next_start;
+        vad_emit(vad, VAD_SPEECH_START);
+      }
+
+      vad->prev_end = 0;
+      vad->next_start = 0;
+      vad->temp_end = 0;
+    } else {
+      vad->current_speech.end = vad->current_sample;
+      vad_push_speech(vad);
+      vad->current_speech = (timestamp_t){-1, -1};
+      vad->prev_end = 0;
+      vad->next_start = 0;
+      vad->temp_end = 0;
+      vad->triggered = false;
+    }
+    return;
+  }
+
+  if ((speech_prob >= (vad->threshold - 0.15f)) &&
+      (speech_prob < vad->threshold)) {
+    return;
+  }
+
+  if (speech_prob < (vad->threshold - 0.15f)) {
+    if (vad->triggered) {
+      if (vad->temp_end == 0)
+        vad->temp_end = vad->current_sample;
+
+      if (vad->current_sample - vad->temp_end >
+          vad->min_silence_samples_at_max_speech)
+        vad->prev_end = vad->temp_end;
+
+      if (vad->current_sample - vad->temp_end >= vad->min_silence_samples) {
+        vad->current_speech.end = vad->temp_end;
+        if ((vad->current_speech.end - vad->current_speech.start) >
+            vad->min_speech_samples) {
+          vad_push_speech(vad);
+          vad->current_speech = (timestamp_t){-1, -1};
+          vad->prev_end = 0;
+          vad->next_start = 0;
+          vad->temp_end = 0;
+          vad->triggered = false;
+        }
+      }
+    }
+    return;
+  }
+}
+
+/* --- Skipping Inference --- */
+
+// Lane-wise partial sums keep both loops vectorizable without -ffast-math
+constexpr size_t gate_lanes = 16U;
+
+// Whether the new samples of a window are quiet enough to skip inference
+static bool vad_window_quiet(const vad_stream_t *vad, const float *chunk) {
+  if (vad->gate_energy <= 0.0f) {
+    return false;
+  }
+  const size_t n = (size_t)vad->window_size_samples;
+  float energy[gate_lanes] = {};
+  float peak[gate_lanes] = {};
+  size_t i = 0;
+  for (; i + gate_lanes <= n; i += gate_lanes) {
+    for (size_t l = 0; l < gate_lanes; l++) {
+      const float v = chunk[i + l];
+      const float magnitude = fabsf(v);
+      energy[l] += v * v;
+      peak[l] = magnitude > peak[l] ? magnitude : peak[l];
+    }
+  }
+  for (size_t l = 0; i < n; i++, l++) {
+    const float magnitude = fabsf(chunk[i]);
+    energy[l] += chunk[i] * chunk[i];
+    peak[l] = magnitude > peak[l] ? magnitude : peak[l];
+  }
+
+  float total = 0.0f;
+  float largest = 0.0f;
+  for (size_t l = 0; l < gate_lanes; l++) {
+    total += energy[l];
+    largest = peak[l] > largest ? peak[l] : largest;
+  }
+  return total < vad->gate_energy && largest < vad->gate_peak;
+}
+
+// Segment a probability the model produced, tracking how long it has been
+// confidently on one side for the adaptive stride.
+static void vad_update_inferred(vad_stream_t *vad, float speech_prob) {
+  if (vad->stride > 1) {
+    int side = 0;
+    if (speech_prob >= vad->threshold + 0.15f) {
+      side = 1;
+    } else if (speech_prob < vad->threshold - 0.15f) {
+      side = -1;
+    }
+    if (side == 0) {
+      vad->confident_run = 0;
+    } else if ((vad->confident_run > 0) == (side > 0) &&
+               vad->confident_run != 0) {
+      vad->confident_run += side;
+    } else {
+      vad->confident_run = side;
+    }
+    if (abs(vad->confident_run) >= vad->stride_after) {
+      vad->stride_skip = vad->stride - 1;
+    }
+    vad->held_prob = speech_prob;
+  }
+  vad_update(vad, speech_prob);
+}
+
+// Whether the model can skip this window: it falls inside a stride or the
+// energy gate finds it quiet. Either way it is segmented here with the
+// state left as is; callers keep the context moving.
+[[nodiscard]]
+static bool vad_skip_window(vad_stream_t *vad, const float *chunk) {
+  if (vad->stride_skip > 0) {
+    vad->stride_skip--;
+    vad->windows_strided++;
+    vad_update(vad, vad->held_prob);
+    return true;
+  }
+  if (vad_window_quiet(vad, chunk)) {
+    vad->windows_gated++;
+    vad_update(vad, 0.0f);
+    return true;
+  }
+  return false;
+}
+
+// Streams run either on the native engine or on their ORT bindings
+static bool vad_stream_ready(const vad_stream_t *vad) {
+  return vad->native_net != nullptr ||
+         (vad->model != nullptr && vad->binding != nullptr);
+}
+
+// Core inference logic: run the window staged in input_buffer
+static void vad_predict_staged(vad_stream_t *vad) {
+  if (vad_skip_window(vad, vad->input_buffer + vad->context_samples)) {
+    memmove(vad->input_buffer, vad->input_buffer + vad->window_size_samples,
+            vad->context_samples * sizeof(float));
+    return;
+  }
+
+  float speech_prob = 0.0f;
+  if (vad->native_net != nullptr) {
+    speech_prob = vad_native_run(vad->native_net, vad->input_buffer,
+                                 (size_t)vad->effective_window_size,
+                                 vad->state, vad->state_out);
+  } else {
+#ifndef SILERO_VAD_NO_ORT
+    const auto g = vad->model->g_ort;
+
+    // Every tensor is preallocated and bound in init
+    check_status(g,
+                 g->RunWithBinding(vad->model->session, nullptr, vad->binding));
+    speech_prob = vad->output_buffer[0];
+#endif
+  }
+
+  // stateN of this window is the state input of the next one
+  swap_state_buffers(vad);
+
+  // Update context: last context_samples of the current window
+  memmove(vad->input_buffer, vad->input_buffer + vad->window_size_samples,
+          vad->context_samples * sizeof(float));
+
+  vad_update_inferred(vad, speech_prob);
+}
+
+static void vad_predict(vad_stream_t *vad, const float *data_chunk) {
+  if (vad == nullptr || data_chunk == nullptr) {
+    return;
+  }
+
+  if (!vad_stream_ready(vad)) {
+    return;
+  }
+
+  // Prepare Input Buffer: [Context (64)] + [Chunk (WindowSize)]
+  // The context head already holds the tail of the previous window.
+  memcpy(vad->input_buffer + vad->context_samples, data_chunk,
+         vad->window_size_samples * sizeof(float));
+
+  vad_predict_staged(vad);
+}
+
+// Variant for contiguous audio: `window` points at effective_window_size
+// caller samples, context included, so no context has to be stitched on.
+// Only the native engine reads them without a copy. ORT windows are copied
+// into the bound input_buffer, since a tensor per window costs more than the
+// copy it saves. Either way the context head of input_buffer may be stale
+// afterwards; callers refresh it before staging.
+static void vad_predict_contiguous(vad_stream_t *vad, const float *window) {
+  if (vad_skip_window(vad, window + vad->context_samples)) {
+    return;
+  }
+
+  float speech_prob = 0.0f;
+  if (vad->native_net != nullptr) {
+    speech_prob = vad_native_run(vad->native_net, window,
+                                 (size_t)vad->effective_window_size,
+                                 vad->state, vad->state_out);
+  } else {
+#ifndef SILERO_VAD_NO_ORT
+    memcpy(vad->input_buffer, window,
+           (size_t)vad->effective_window_size * sizeof(float));
+    check_status(vad->model->g_ort,
+                 vad->model->g_ort->RunWithBinding(vad->model->session,
+                                                   nullptr, vad->binding));
+    speech_prob = vad->output_buffer[0];
+#endif
+  }
+
+  swap_state_buffers(vad);
+  vad_update_inferred(vad, speech_prob);
+}
+
+// Close a segment still open at the end of the audio
+static void vad_finish(vad_stream_t *vad, size_t audio_length_samples) {
+  if (vad->current_speech.start >= 0) {
+    vad->current_speech.end = (int64_t)audio_length_samples;
+    vad_push_speech(vad);
+    vad->current_speech = (timestamp_t){-1, -1};
+    vad->prev_end = 0;
+    vad->next_start = 0;
+    vad->temp_end = 0;
+    vad->triggered = false;
+  }
+}
+
+// Offline paths run blocks of consecutive windows. Score the quiet windows
+// at sample j and step past them, then count how many of the next ones (at
+// most `limit`) pass the gate: they form the next block. 0 at the end.
+static size_t vad_next_block(vad_stream_t *vad, const float *input_wav,
+                             size_t *j, size_t audio_length_samples,
+                             size_t limit) {
+  const size_t chunk = (size_t)vad->window_size_samples;
+  while (*j + chunk <= audio_length_samples &&
+         vad_skip_window(vad, &input_wav[*j])) {
+    *j += chunk;
+  }
+  size_t windows = 0;
+  while (windows < limit &&
+         *j + (windows + 1U) * chunk <= audio_length_samples &&
+         (windows == 0U ||
+          !vad_window_quiet(vad, &input_wav[*j + windows * chunk]))) {
+    windows++;
+  }
+  return windows;
+}
+
+// The stream's block staging, at least `size` floats; nullptr when it
+// cannot grow, and the caller takes the per-window path instead
+static float *vad_block_scratch(vad_stream_t *vad, size_t size) {
+  if (vad->block_scratch_size < size) {
+    auto scratch = (float *)realloc(vad->block_scratch, size * sizeof(float));
+    if (scratch == nullptr) {
+      return nullptr;
+    }
+    vad->block_scratch = scratch;
+    vad->block_scratch_size = size;
+  }
+  return vad->block_scratch;
+}
+
+// Windows per native encoder call in offline mode: each weight row is reused
+// across all of their frames, and the activations still fit in L2.
+constexpr size_t native_offline_block = 16U;
+
+// Two-phase offline inference on the native engine, from sample j (past the
+// first context) on: run the stateless STFT and encoder for a block of
+// windows in one call, then only the LSTM step and decoder window by window.
+// Returns where it stopped; the caller finishes on the per-window path, which
+// is also the fallback when the scratch cannot be allocated.
+static size_t vad_process_native_offline(vad_stream_t *vad,
+                                         const float *input_wav, size_t j,
+                                         size_t audio_length_samples) {
+  const auto net = vad->native_net;
+  const size_t chunk = (size_t)vad->window_size_samples;
+  const size_t context = (size_t)vad->context_samples;
+  const size_t effective = (size_t)vad->effective_window_size;
+
+  const size_t gates = 4U * (size_t)net->hidden;
+  const size_t features_size = native_offline_block * gates;
+  const size_t workspace_size =
+      vad_native_workspace_size(net, effective, native_offline_block);
+  float *scratch = vad_block_scratch(vad, features_size + workspace_size);
+  if (scratch == nullptr) {
+    return j;
+  }
+  float *features = scratch;
+  float *workspace = scratch + features_size;
+
+  size_t windows = 0;
+  while ((windows = vad_next_block(vad, input_wav, &j, audio_length_samples,
+                                   native_offline_block)) > 0U) {
+    // 1. Front end for the whole block; windows overlap by the context
+    vad_native_encode(net, &input_wav[j - context], chunk, effective, windows,
+                      workspace, features);
+
+    // 2. Recurrent half in audio order
+    for (size_t i = 0; i < windows; i++) {
+      const auto speech_prob =
+          vad_native_decode(net, features + i * gates, vad->state,
+                            vad->state_out);
+      swap_state_buffers(vad);
+      vad_update_inferred(vad, speech_prob);
+    }
+    j += windows * chunk;
+  }
+  return j;
+}
+
+// Windows per Run on a scan model, about 4 s of 32 ms windows: enough to
+// amortize the per-Run overhead, while the staged block stays cache-sized.
+constexpr size_t scan_block = 128U;
+
+// Offline inference on a scan model from sample j (past the first context)
+// on: stage a block of overlapping windows and step through all of them in
+// one Run. Returns where it stopped, like vad_process_native_offline.
+static size_t vad_process_scan(vad_stream_t *vad, const float *input_wav,
+                               size_t j, size_t audio_length_samples) {
+#ifndef SILERO_VAD_NO_ORT
+  const auto model = vad->model;
+  const auto g = model->g_ort;
+  const size_t chunk = (size_t)vad->window_size_samples;
+  const size_t context = (size_t)vad->context_samples;
+  const size_t effective = (size_t)vad->effective_window_size;
+
+  float *input = vad_block_scratch(vad, scan_block * (effective + 1U));
+  if (input == nullptr) {
+    return j;
+  }
+  float *probs = input + scan_block * effective;
+
+  size_t windows = 0;
+  while ((windows = vad_next_block(vad, input_wav, &j, audio_length_samples,
+                                   scan_block)) > 0U) {
+    for (size_t i = 0; i < windows; i++) {
+      memcpy(input + i * effective, &input_wav[j + i * chunk - context],
+             effective * sizeof(float));
+    }
+
+    int64_t input_dims[3];
+    int64_t output_dims[3];
+    const size_t input_rank =
+        window_dims(model, windows, 1U, (int64_t)effective, input_dims);
+    const size_t output_rank = window_dims(model, windows, 1U, 1, output_dims);
+    OrtValue *input_ort = create_tensor(
+        g, model->memory_info, input, windows * effective * sizeof(float),
+        input_dims, input_rank, ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT);
+    OrtValue *output_ort = create_tensor(
+        g, model->memory_info, probs, windows * sizeof(float), output_dims,
+        output_rank, ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT);
+
+    const OrtValue *inputs[] = {input_ort, vad->state_ort, vad->sr_ort};
+    OrtValue *outputs[] = {output_ort, vad->state_out_ort};
+    check_status(g, g->Run(model->session, nullptr, input_names, inputs, 3,
+                           output_names, 2, outputs));
+    g->ReleaseValue(input_ort);
+    g->ReleaseValue(output_ort);
+
+    // stateN is the state after the last window of the block
+    swap_state_buffers(vad);
+    for (size_t i = 0; i < windows; i++) {
+      vad_update_inferred(vad, probs[i]);
+    }
+    j += windows * chunk;
+  }
+#else
+  (void)vad;
+  (void)input_wav;
+  (void)audio_length_samples;
+#endif
+  return j;
+}
+
+// Every whole window starting at sample j, on whichever path fits; returns
+// where the windows stop. Past the first context_samples the caller's buffer
+// already holds [context | chunk] contiguously, so only the first window
+// (zero context) is staged; ORT still copies each window into its binding.
+static size_t vad_process_windows(vad_stream_t *vad, const float *input_wav,
+                                  size_t j, size_t audio_length_samples) {
+  const size_t chunk = (size_t)vad->window_size_samples;
+  const size_t context = (size_t)vad->context_samples;
+
+  for (; j < context && j + chunk <= audio_length_samples; j += chunk) {
+    vad_predict(vad, &input_wav[j]);
+  }
+  // The block paths run every window they take; an adaptive stride needs
+  // each probability before it knows which window comes next. A single
+  // window, as in most feeds, gains nothing from a block.
+  const bool blocks =
+      vad->stride <= 1 && j + 2U * chunk <= audio_length_samples;
+  if (blocks && vad->native_net != nullptr) {
+    j = vad_process_native_offline(vad, input_wav, j, audio_length_samples);
+  } else if (blocks && vad->model->is_scan) {
+    j = vad_process_scan(vad, input_wav, j, audio_length_samples);
+  }
+  for (; j + chunk <= audio_length_samples; j += chunk) {
+    vad_predict_contiguous(vad, &input_wav[j - context]);
+  }
+  return j;
+}
+
+// The partial window left at sample j, zero-padded through input_buffer
+static void vad_process_tail(vad_stream_t *vad, const float *input_wav,
+                             size_t j, size_t audio_length_samples) {
+  const size_t chunk = (size_t)vad->window_size_samples;
+  const size_t context = (size_t)vad->context_samples;
+  const size_t remaining = audio_length_samples - j;
+  if (remaining == 0U) {
+    return;
+  }
+  if (j >= context) {
+    memcpy(vad->input_buffer, &input_wav[j - context],
+           context * sizeof(float));
+  }
+  memcpy(vad->input_buffer + context, &input_wav[j],
+         remaining * sizeof(float));
+  memset(vad->input_buffer + context + remaining, 0,
+         (chunk - remaining) * sizeof(float));
+  vad_predict_staged(vad);
+}
+
+void vad_iterator_process(vad_iterator_t *vad, const float *input_wav,
+                          size_t audio_length_samples) {
+  if (vad == nullptr || input_wav == nullptr) {
+    return;
+  }
+
+  if (vad->window_size_samples == 0 || !vad_stream_ready(vad)) {
+    return;
+  }
+
+  vad_iterator_reset_states(vad);
+  const size_t j =
+      vad_process_windows(vad, input_wav, 0U, audio_length_samples);
+  vad_process_tail(vad, input_wav, j, audio_length_samples);
+  vad_finish(vad, audio_length_samples);
+}
+
+// Probability callback that fills the arrays of vad_iterator_process_probs,
+// passing each window on to the caller's own callback
+typedef struct {
+  float *probs;
+  uint8_t *probs_u8;
+  int64_t first;
+  int64_t window;
+  vad_prob_callback_t chained;
+  void *chained_user_data;
+} prob_sink_t;
+
+static void prob_sink_store(int64_t start, float speech_prob,
+                            void *user_data) {
+  prob_sink_t *sink = user_data;
+  const auto w = (size_t)((start - sink->first) / sink->window);
+  if (sink->probs != nullptr) {
+    sink->probs[w] = speech_prob;
+  } else {
+    const float p = fminf(fmaxf(speech_prob, 0.0f), 1.0f);
+    sink->probs_u8[w] = (uint8_t)lrintf(p * 255.0f);
+  }
+  if (sink->chained != nullptr) {
+    sink->chained(start, speech_prob, sink->chained_user_data);
+  }
+}
+
+static void vad_iterator_process_into(vad_iterator_t *vad,
+                                      const float *input_wav,
+                                      size_t audio_length_samples,
+                                      prob_sink_t sink) {
+  if (vad == nullptr) {
+    return;
+  }
+  // process resets the stream, so its first window starts at the epoch
+  sink.first = vad->epoch;
+  sink.window = vad->window_size_samples;
+  sink.chained = vad->on_prob;
+  sink.chained_user_data = vad->prob_user_data;
+  vad->on_prob = prob_sink_store;
+  vad->prob_user_data = &sink;
+  vad_iterator_process(vad, input_wav, audio_length_samples);
+  vad->on_prob = sink.chained;
+  vad->prob_user_data = sink.chained_user_data;
+}
+
+void vad_iterator_process_probs(vad_iterator_t *vad, const float *input_wav,
+                                size_t audio_length_samples, float *probs) {
+  if (probs == nullptr) {
+    vad_iterator_process(vad, input_wav, audio_length_samples);
+    return;
+  }
+  vad_iterator_process_into(vad, input_wav, audio_length_samples,
+                            (prob_sink_t){.probs = probs});
+}
+
+void vad_iterator_process_probs_u8(vad_iterator_t *vad,
+                                   const float *input_wav,
+                                   size_t audio_length_samples,
+                                   uint8_t *probs) {
+  if (probs == nullptr) {
+    vad_iterator_process(vad, input_wav, audio_length_samples);
+    return;
+  }
+  vad_iterator_process_into(vad, input_wav, audio_length_samples,
+                            (prob_sink_t){.probs_u8 = probs});
+}
+
+/* --- Offline Segmentation --- */
+
+size_t vad_segment_probs(const float *probs, size_t n,
+                         const vad_segment_params_t *params, timestamp_t *out,
+                         size_t capacity) {
+  if (probs == nullptr || params == nullptr) {
+    return 0U;
+  }
+
+  // A stream with segmentation only: no buffers, model or callbacks
+  vad_stream_t vad = {};
+  vad_segmentation_setup(&vad, params->sample_rate,
+                         params->window_frame_size_ms, params->threshold,
+                         params->min_silence_ms, params->speech_pad_ms,
+                         params->min_speech_ms, params->max_speech_s);
+  if (vad.window_size_samples <= 0) {
+    return 0U;
+  }
+  vec_init(&vad.speeches);
+  vad.current_speech = (timestamp_t){-1, -1};
+
+  for (size_t w = 0; w < n; w++) {
+    vad_update(&vad, probs[w]);
+  }
+  const size_t length = params->audio_length_samples != 0U
+                            ? params->audio_length_samples
+                            : n * (size_t)vad.window_size_samples;
+  vad_finish(&vad, length);
+
+  const size_t found = vad.speeches.size;
+  vec_drain(&vad.speeches, out, capacity);
+  vec_free(&vad.speeches);
+  return found;
+}
+
+/* --- Push Streaming --- */
+
+void vad_stream_feed(vad_stream_t *vad, const float *samples, size_t n) {
+  if (vad == nullptr || samples == nullptr || n == 0U) {
+    return;
+  }
+  if (vad->window_size_samples == 0 || !vad_stream_ready(vad)) {
+    return;
+  }
+
+  const size_t chunk = (size_t)vad->window_size_samples;
+  const size_t context = (size_t)vad->context_samples;
+  float *staged = vad->input_buffer + context;
+
+  // Top up the window the last call left partial
+  size_t j = 0;
+  if (vad->pending > 0U) {
+    j = chunk - vad->pending < n ? chunk - vad->pending : n;
+    memcpy(staged + vad->pending, samples, j * sizeof(float));
+    vad->pending += j;
+    if (vad->pending < chunk) {
+      return;
+    }
+    vad_predict_staged(vad);
+    vad->pending = 0U;
+  }
+
+  // Whole windows straight from the caller's samples; those that ran
+  // contiguously leave the context head of input_buffer stale
+  j = vad_process_windows(vad, samples, j, n);
+  if (j >= context) {
+    memcpy(vad->input_buffer, &samples[j - context], context * sizeof(float));
+  }
+
+  vad->pending = n - j;
+  memcpy(staged, &samples[j], vad->pending * sizeof(float));
+}
+
+void vad_stream_flush(vad_stream_t *vad) {
+  if (vad == nullptr || vad->window_size_samples == 0 ||
+      !vad_stream_ready(vad)) {
+    return;
+  }
+
+  const size_t length = (size_t)vad->current_sample + vad->pending;
+  if (vad->pending > 0U) {
+    const size_t chunk = (size_t)vad->window_size_samples;
+    memset(vad->input_buffer + vad->context_samples + vad->pending, 0,
+           (chunk - vad->pending) * sizeof(float));
+    vad_predict_staged(vad);
+    vad->pending = 0U;
+  }
+  vad_finish(vad, length);
+}
+
+/* --- Sharded Offline Processing --- */
+
+// Audio each shard after the first runs before its own windows, so its
+// state has settled by the time they start
+constexpr int shard_warmup_ms = 2'000;
+
+// Shards shorter than this many warm-up lengths are not worth a thread
+constexpr size_t shard_min_warmups = 4U;
+
+// A contiguous piece of the windows and the stream that scores it
+typedef struct {
+  vad_stream_t *stream; // records probabilities, never segments
+  const float *input_wav;
+  size_t audio_length_samples;
+  size_t warmup_begin; // sample the warm-up starts at
+  size_t begin;        // first sample of the shard's own windows
+  size_t end;          // where they stop; the last shard takes the tail
+  float *probs;        // warm-up windows first, then the shard's
+  size_t warmup_windows;
+  size_t windows_gated;
+  bool threaded;
+  // Settings of a caller's batch lane, put back once the lanes are done
+  int lane_stride_after;
+  int lane_stride;
+  float lane_gate_energy;
+  float lane_gate_peak;
+} vad_shard_t;
+
+// How many shards the audio has room for, at most `wanted`, and the warm-up
+// in windows. Below 2 the caller takes the single pass.
+static size_t vad_shard_count(const vad_stream_t *vad,
+                              size_t audio_length_samples, size_t wanted,
+                              size_t *warmup_windows) {
+  const size_t chunk = (size_t)vad->window_size_samples;
+  const size_t windows = audio_length_samples / chunk;
+  *warmup_windows =
+      ((size_t)shard_warmup_ms * (size_t)vad->sr_per_ms + chunk - 1U) / chunk;
+  const size_t most = windows / (shard_min_warmups * *warmup_windows);
+  // A stride has to see every probability in order
+  if (vad->stride > 1) {
+    return 1U;
+  }
+  return wanted < most ? wanted : most;
+}
+
+// Bounds of shard `index` and its probability log
+[[nodiscard]]
+static bool vad_shard_setup(vad_shard_t *shard, vad_stream_t *stream,
+                            const float *input_wav,
+                            size_t audio_length_samples, size_t index,
+                            size_t shards, size_t warmup_windows) {
+  const size_t chunk = (size_t)stream->window_size_samples;
+  const size_t windows = audio_length_samples / chunk;
+  const size_t first = index * windows / shards;
+  const size_t last = (index + 1U) * windows / shards;
+  const size_t warmup = first < warmup_windows ? first : warmup_windows;
+  shard->stream = stream;
+  shard->input_wav = input_wav;
+  shard->audio_length_samples = audio_length_samples;
+  shard->warmup_begin = (first - warmup) * chunk;
+  shard->begin = first * chunk;
+  shard->end = index + 1U == shards ? audio_length_samples : last * chunk;
+  shard->warmup_windows = warmup;
+  // One more for the tail window of the last shard
+  shard->probs = (float *)malloc((warmup + last - first + 1U) * sizeof(float));
+  return shard->probs != nullptr;
+}
+
+// Segment the shards' own windows in audio order, as one pass would have
+static void vad_shards_segment(vad_stream_t *vad, const vad_shard_t *parts,
+                               size_t shards, size_t audio_length_samples) {
+  const size_t chunk = (size_t)vad->window_size_samples;
+  vad_iterator_reset_states(vad);
+  for (size_t i = 0; i < shards; i++) {
+    const auto shard = &parts[i];
+    const size_t logged = (size_t)shard->stream->current_sample / chunk;
+    for (size_t w = shard->warmup_windows; w < logged; w++) {
+      vad_update(vad, shard->probs[w]);
+    }
+    vad->windows_gated += shard->windows_gated;
+  }
+  vad_finish(vad, audio_length_samples);
+}
+
+static int vad_shard_run(void *arg) {
+  vad_shard_t *shard = arg;
+  const auto vad = shard->stream;
+  vad_iterator_reset_states(vad);
+  vad->prob_log = shard->probs;
+
+  size_t j = vad_process_windows(vad, shard->input_wav, shard->warmup_begin,
+                                 shard->begin);
+  const size_t gated = vad->windows_gated;
+  j = vad_process_windows(vad, shard->input_wav, j, shard->end);
+  if (shard->end == shard->audio_length_samples) {
+    vad_process_tail(vad, shard->input_wav, j, shard->end);
+  }
+  shard->windows_gated = vad->windows_gated - gated;
+  return 0;
+}
+
+void vad_iterator_process_parallel(vad_iterator_t *vad,
+                                   const float *input_wav,
+                                   size_t audio_length_samples,
+                                   size_t shards) {
+  if (vad == nullptr || input_wav == nullptr) {
+    return;
+  }
+  if (vad->window_size_samples == 0 || !vad_stream_ready(vad)) {
+    return;
+  }
+
+  size_t warmup_windows = 0;
+  shards = vad_shard_count(vad, audio_length_samples, shards, &warmup_windows);
+  if (shards <= 1U) {
+    vad_iterator_process(vad, input_wav, audio_length_samples);
+    return;
+  }
+
+  auto parts = (vad_shard_t *)calloc(shards, sizeof(vad_shard_t));
+  auto streams = (vad_stream_t *)calloc(shards, sizeof(vad_stream_t));
+  auto threads = (thrd_t *)calloc(shards, sizeof(thrd_t));
+  bool ready = parts != nullptr && streams != nullptr && threads != nullptr;
+  size_t count = 0;
+  for (; ready && count < shards; count++) {
+    const auto stream = &streams[count];
+    ready = vad_stream_init(stream, vad->model, vad->sample_rate,
+                            vad->window_size_samples / vad->sr_per_ms,
+                            vad->threshold, 0, 0, 0, INFINITY) &&
+            vad_shard_setup(&parts[count], stream, input_wav,
+                            audio_length_samples, count, shards,
+                            warmup_windows);
+    stream->gate_energy = vad->gate_energy;
+    stream->gate_peak = vad->gate_peak;
+  }
+
+  if (ready) {
+    // Shard 0 runs here, as does any shard whose thread cannot start
+    for (size_t i = 1; i < shards; i++) {
+      parts[i].threaded =
+          thrd_create(&threads[i], vad_shard_run, &parts[i]) == thrd_success;
+    }
+    vad_shard_run(&parts[0]);
+    for (size_t i = 1; i < shards; i++) {
+      if (parts[i].threaded) {
+        thrd_join(threads[i], nullptr);
+      } else {
+        vad_shard_run(&parts[i]);
+      }
+    }
+    vad_shards_segment(vad, parts, shards, audio_length_samples);
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    vad_stream_free(&streams[i]);
+    free(parts[i].probs);
+  }
+  free(parts);
+  free(streams);
+  free(threads);
+  if (!ready) {
+    vad_iterator_process(vad, input_wav, audio_length_samples);
+  }
+}
+
+// First end of a window stepped from `from` that lies past `target`
+static int64_t window_end_past(int64_t from, int64_t window, double target) {
+  if (target < (double)from) {
+    return from + window;
+  }
+  return from +
+         ((int64_t)((target - (double)from) / (double)window) + 1) * window;
+}
+
+void vad_iterator_skip(vad_iterator_t *vad, size_t n_samples) {
+  if (vad == nullptr || vad->window_size_samples <= 0 ||
+      vad->state == nullptr || vad->input_buffer == nullptr) {
+    return;
+  }
+
+  const size_t chunk = (size_t)vad->window_size_samples;
+  const size_t context = (size_t)vad->context_samples;
+  float *staged = vad->input_buffer + context;
+
+  // A partial window fed before the gap holds real audio: the gap completes
+  // it with zeros and it runs like any other window
+  if (vad->pending > 0U) {
+    const size_t zeros =
+        chunk - vad->pending < n_samples ? chunk - vad->pending : n_samples;
+    memset(staged + vad->pending, 0, zeros * sizeof(float));
+    vad->pending += zeros;
+    n_samples -= zeros;
+    if (vad->pending < chunk) {
+      return;
+    }
+    vad_predict_staged(vad);
+    vad->pending = 0U;
+  }
+
+  // Over silence, vad_update only changes anything at a few windows: the
+  // first, and those where the silence or speech crosses one of its limits.
+  // Jump straight to each of them; between them and once untriggered, the
+  // windows would only have moved current_sample.
+  const int64_t window = vad->window_size_samples;
+  const size_t windows = n_samples / chunk;
+  const int64_t end = vad->current_sample + (int64_t)(windows * chunk);
+  // With a threshold of 0.15 or less, 0 is not silence but in the band or
+  // speech, and only the first window or the maximum speech length matter
+  const bool zero_is_speech = 0.0f >= vad->threshold;
+  const bool zero_in_band = 0.0f >= vad->threshold - 0.15f;
+  if (zero_is_speech) {
+    if (windows > 0U) {
+      vad_update(vad, 0.0f);
+    }
+  } else {
+    while (vad->triggered) {
+      const int64_t from = vad->current_sample;
+      // In the band silence never starts, and only the maximum speech
+      // length can close the segment
+      double target =
+          (double)vad->current_speech.start + vad->max_speech_samples;
+      if (!zero_in_band && vad->temp_end == 0) {
+        target = (double)from;
+      } else if (!zero_in_band) {
+        if (vad->prev_end != vad->temp_end) {
+          target = fmin(target, (double)vad->temp_end +
+                                    vad->min_silence_samples_at_max_speech);
+        }
+        if (vad->current_speech.end != vad->temp_end) {
+          target = fmin(target,
+                        (double)vad->temp_end + vad->min_silence_samples - 1);
+        }
+      }
+      if (isinf(target)) {
+        break;
+      }
+      const int64_t next = window_end_past(from, window, target);
+      if (next > end) {
+        break;
+      }
+      vad->current_sample = next - window;
+      vad_update(vad, 0.0f);
+    }
+  }
+  vad->current_sample = end;
+
+  // Nothing of the audio before the gap carries over. A gap that does not
+  // end on a window boundary leaves its last samples pending, as zeros, for
+  // the next feed to complete.
+  memset(vad->state, 0, vad->size_state * sizeof(float));
+  memset(vad->input_buffer, 0, vad->context_samples * sizeof(float));
+  vad->pending = n_samples - windows * chunk;
+  memset(staged, 0, vad->pending * sizeof(float));
+  vad->confident_run = 0;
+  vad->stride_skip = 0;
+}
+
+/* --- Batched Streams --- */
+
+#ifndef SILERO_VAD_NO_ORT
+// (Re)wrap the batched buffers for `rows` active streams. Shapes only change
+// when the number of active streams does, so steady state does not allocate.
+static void vad_batch_bind(vad_batch_t *batch, size_t rows) {
+  if (rows == batch->bound_rows) {
+    return;
+  }
+
+  const auto g = batch->model->g_ort;
+  const auto memory_info = batch->model->memory_info;
+  const auto lane = &batch->streams[0];
+
+  g->ReleaseValue(batch->input_ort);
+  g->ReleaseValue(batch->state_ort);
+  g->ReleaseValue(batch->output_ort);
+  g->ReleaseValue(batch->state_out_ort);
+
+  int64_t input_dims[3];
+  int64_t output_dims[3];
+  const size_t input_rank = window_dims(batch->model, 1U, rows,
+                                        lane->effective_window_size,
+                                        input_dims);
+  const size_t output_rank =
+      window_dims(batch->model, 1U, rows, 1, output_dims);
+  const int64_t state_dims[] = {state_channels, (int64_t)rows, state_width};
+  const size_t state_bytes = rows * lane->size_state * sizeof(float);
+
+  batch->input_ort = create_tensor(
+      g, memory_info, batch->input_buffer,
+      rows * (size_t)lane->effective_window_size * sizeof(float), input_dims,
+      input_rank, ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT);
+  batch->state_ort =
+      create_tensor(g, memory_info, batch->state, state_bytes,
+                    state_dims, 3, ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT);
+  batch->output_ort = create_tensor(g, memory_info,
+                                    batch->output_buffer, rows * sizeof(float),
+                                    output_dims, output_rank,
+                                    ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT);
+  batch->state_out_ort =
+      create_tensor(g, memory_info, batch->state_out, state_bytes,
+                    state_dims, 3, ONNX_TENSOR_ELEMENT_DATA_TYPE_FLOAT);
+
+  check_status(g, g->BindInput(batch->binding, "input", batch->input_ort));
+  check_status(g, g->BindInput(batch->binding, "state", batch->state_ort));
+  check_status(g, g->BindOutput(batch->binding, "output", batch->output_ort));
+  check_status(g,
+               g->BindOutput(batch->binding, "stateN", batch->state_out_ort));
+
+  batch->bound_rows = rows;
+}
+#endif
+
+[[nodiscard]]
+bool vad_batch_init(vad_batch_t *batch, vad_model_t *model, size_t batch_size,
+                    int sample_rate, int window_frame_size_ms, float threshold,
+                    int min_silence_ms, int speech_pad_ms, int min_speech_ms,
+                    float max_speech_s) {
+  if (batch == nullptr || model == nullptr || batch_size == 0U) {
+    return false;
+  }
+
+  memset(batch, 0, sizeof(*batch));
+
+  if (!check_sample_rate(model, sample_rate)) {
+    return false;
+  }
+
+  // 1. Streams: context, state and segmentation, no ONNX Runtime resources
+  batch->streams = (vad_stream_t *)calloc(batch_size, sizeof(vad_stream_t));
+  if (batch->streams == nullptr) {
+    return false;
+  }
+  batch->batch_size = batch_size;
+
+  for (size_t i = 0; i < batch_size; i++) {
+    if (!vad_stream_setup(&batch->streams[i], sample_rate,
+                            window_frame_size_ms, threshold, min_silence_ms,
+                            speech_pad_ms, min_speech_ms, max_speech_s)) {
+      vad_batch_free(batch);
+      return false;
+    }
+  }
+
+  // 2. Batched buffers: input [B, effective], state [2, B, 128], output [B]
+  const auto lane = &batch->streams[0];
+  size_t input_count = 0;
+  size_t state_count = 0;
+  if (ckd_mul(&input_count, batch_size, (size_t)lane->effective_window_size) ||
+      ckd_mul(&state_count, batch_size, (size_t)lane->size_state)) {
+    vad_batch_free(batch);
+    return false;
+  }
+
+  batch->input_buffer = (float *)calloc(input_count, sizeof(float));
+  batch->state = (float *)calloc(state_count, sizeof(float));
+  batch->state_out = (float *)calloc(state_count, sizeof(float));
+  batch->output_buffer = (float *)calloc(batch_size, sizeof(float));
+  batch->sr_tensor_data = (int64_t *)calloc(1, sizeof(int64_t));
+  batch->rows = (size_t *)calloc(batch_size, sizeof(size_t));
+
+  if (batch->input_buffer == nullptr || batch->state == nullptr ||
+      batch->state_out == nullptr || batch->output_buffer == nullptr ||
+      batch->sr_tensor_data == nullptr || batch->rows == nullptr) {
+    vad_batch_free(batch);
+    return false;
+  }
+
+  *batch->sr_tensor_data = sample_rate;
+
+  // 3. Bind to the shared model
+  batch->model = vad_model_retain(model);
+
+  // Native weights run each stream on its own buffers
+  if (model->native != nullptr) {
+    const auto net = vad_native_net_for(model->native, sample_rate);
+    if (!vad_native_supports(net, (size_t)lane->effective_window_size)) {
+      fprintf(stderr, "Native engine does not support %d ms windows\n",
+              window_frame_size_ms);
+      vad_batch_free(batch);
+      return false;
+    }
+    for (size_t i = 0; i < batch_size; i++) {
+      batch->streams[i].native_net = net;
+    }
+    return true;
+  }
+
+#ifndef SILERO_VAD_NO_ORT
+  const auto g = model->g_ort;
+
+  const int64_t sr_dims[] = {1};
+  batch->sr_ort =
+      create_tensor(g, model->memory_info, batch->sr_tensor_data,
+                    sizeof(int64_t), sr_dims, 1,
+                    ONNX_TENSOR_ELEMENT_DATA_TYPE_INT64);
+  check_status(g, g->CreateIoBinding(model->session, &batch->binding));
+  check_status(g, g->BindInput(batch->binding, "sr", batch->sr_ort));
+#endif
+
+  return true;
+}
+
+void vad_batch_reset_stream(vad_batch_t *batch, size_t index) {
+  if (batch == nullptr || index >= batch->batch_size) {
+    return;
+  }
+  vad_iterator_reset_states(&batch->streams[index]);
+}
+
+void vad_batch_process(vad_batch_t *batch, const float *const *chunks) {
+  if (batch == nullptr || chunks == nullptr || batch->model == nullptr) {
+    return;
+  }
+
+  // Native weights: no shared Run to amortize, step each stream in place
+  if (batch->model->native != nullptr) {
+    for (size_t i = 0; i < batch->batch_size; i++) {
+      if (chunks[i] != nullptr) {
+        vad_predict(&batch->streams[i], chunks[i]);
+      }
+    }
+    return;
+  }
+
+#ifndef SILERO_VAD_NO_ORT
+  const auto lane = &batch->streams[0];
+  const size_t window = (size_t)lane->window_size_samples;
+  const size_t context = (size_t)lane->context_samples;
+  const size_t effective = (size_t)lane->effective_window_size;
+
+  // 1. Gather: active streams the gate lets through fill consecutive rows
+  // [context | chunk]
+  size_t rows = 0;
+  for (size_t i = 0; i < batch->batch_size; i++) {
+    if (chunks[i] == nullptr) {
+      continue;
+    }
+    const auto vad = &batch->streams[i];
+    if (vad_skip_window(vad, chunks[i])) {
+      memcpy(vad->input_buffer, chunks[i] + window - context,
+             context * sizeof(float));
+      continue;
+    }
+    const auto row = batch->input_buffer + rows * effective;
+    memcpy(row, vad->input_buffer, context * sizeof(float));
+    memcpy(row + context, chunks[i], window * sizeof(float));
+    batch->rows[rows++] = i;
+  }
+  if (rows == 0U) {
+    return;
+  }
+
+  // State is [2, rows, 128]: h and c of every stream are strided by rows
+  for (size_t r = 0; r < rows; r++) {
+    const auto vad = &batch->streams[batch->rows[r]];
+    for (size_t c = 0; c < state_channels; c++) {
+      memcpy(batch->state + (c * rows + r) * state_width,
+             vad->state + c * state_width, state_width * sizeof(float));
+    }
+  }
+
+  // 2. One Run for every active stream
+  vad_batch_bind(batch, rows);
+  const auto g = batch->model->g_ort;
+  check_status(g, g->RunWithBinding(batch->model->session, nullptr,
+                                    batch->binding));
+
+  // 3. Scatter state and context back, then segment each stream
+  for (size_t r = 0; r < rows; r++) {
+    const auto vad = &batch->streams[batch->rows[r]];
+    for (size_t c = 0; c < state_channels; c++) {
+      memcpy(vad->state + c * state_width,
+             batch->state_out + (c * rows + r) * state_width,
+             state_width * sizeof(float));
+    }
+    memcpy(vad->input_buffer, batch->input_buffer + r * effective + window,
+           context * sizeof(float));
+    vad_update_inferred(vad, batch->output_buffer[r]);
+  }
+#endif
+}
+
+void vad_iterator_process_batched(vad_iterator_t *vad, vad_batch_t *batch,
+                                  const float *input_wav,
+                                  size_t audio_length_samples) {
+  if (vad == nullptr || batch == nullptr || input_wav == nullptr) {
+    return;
+  }
+  if (vad->window_size_samples == 0 || !vad_stream_ready(vad)) {
+    return;
+  }
+
+  size_t warmup_windows = 0;
+  const size_t lanes = vad_shard_count(vad, audio_length_samples,
+                                       batch->batch_size, &warmup_windows);
+  // Native weights have no batched Run to share, and their single pass
+  // already runs the front end in blocks
+  if (lanes <= 1U || batch->model->native != nullptr ||
+      batch->streams[0].sample_rate != vad->sample_rate ||
+      batch->streams[0].window_size_samples != vad->window_size_samples) {
+    vad_iterator_process(vad, input_wav, audio_length_samples);
+    return;
+  }
+
+  const size_t chunk = (size_t)vad->window_size_samples;
+  const size_t context = (size_t)vad->context_samples;
+  auto parts = (vad_shard_t *)calloc(lanes, sizeof(vad_shard_t));
+  auto chunks = (const float **)calloc(batch->batch_size, sizeof(float *));
+  auto tail = (float *)calloc(chunk, sizeof(float));
+  bool ready = parts != nullptr && chunks != nullptr && tail != nullptr;
+  size_t count = 0;
+  for (; ready && count < lanes; count++) {
+    const auto lane = &batch->streams[count];
+    const auto shard = &parts[count];
+    shard->lane_stride_after = lane->stride_after;
+    shard->lane_stride = lane->stride;
+    shard->lane_gate_energy = lane->gate_energy;
+    shard->lane_gate_peak = lane->gate_peak;
+    vad_iterator_reset_states(lane);
+    ready = vad_shard_setup(shard, lane, input_wav, audio_length_samples,
+                            count, lanes, warmup_windows);
+    lane->prob_log = shard->probs;
+    vad_stream_set_adaptive_stride(lane, 0, 0);
+    lane->gate_energy = vad->gate_energy;
+    lane->gate_peak = vad->gate_peak;
+    // Later lanes start mid-audio, with the samples before them as context
+    if (shard->warmup_begin >= context) {
+      memcpy(lane->input_buffer, &input_wav[shard->warmup_begin - context],
+             context * sizeof(float));
+    }
+  }
+
+  if (ready) {
+    // Every lane steps one window per Run until the last one runs out
+    for (size_t step = 0;; step++) {
+      size_t active = 0;
+      for (size_t i = 0; i < lanes; i++) {
+        const auto shard = &parts[i];
+        const size_t j = shard->warmup_begin + step * chunk;
+        if (step == shard->warmup_windows) {
+          shard->windows_gated = shard->stream->windows_gated;
+        }
+        chunks[i] = nullptr;
+        if (j + chunk <= shard->end) {
+          chunks[i] = &input_wav[j];
+        } else if (j < shard->end) {
+          memcpy(tail, &input_wav[j], (shard->end - j) * sizeof(float));
+          chunks[i] = tail;
+        }
+        active += chunks[i] != nullptr ? 1U : 0U;
+      }
+      if (active == 0U) {
+        break;
+      }
+      vad_batch_process(batch, chunks);
+    }
+    for (size_t i = 0; i < lanes; i++) {
+      parts[i].windows_gated =
+          parts[i].stream->windows_gated - parts[i].windows_gated;
+    }
+    vad_shards_segment(vad, parts, lanes, audio_length_samples);
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    const auto lane = &batch->streams[i];
+    lane->prob_log = nullptr;
+    vad_iterator_reset_states(lane);
+    vad_stream_set_adaptive_stride(lane, parts[i].lane_stride_after,
+                                   parts[i].lane_stride);
+    lane->gate_energy = parts[i].lane_gate_energy;
+    lane->gate_peak = parts[i].lane_gate_peak;
+    free(parts[i].probs);
+  }
+  free(parts);
+  free(chunks);
+  free(tail);
+  if (!ready) {
+    vad_iterator_process(vad, input_wav, audio_length_samples);
+  }
+}
+
+void vad_batch_finish_stream(vad_batch_t *batch, size_t index,
+                             size_t audio_length_samples) {
+  if (batch == nullptr || index >= batch->batch_size) {
+    return;
+  }
+  vad_finish(&batch->streams[index], audio_length_samples);
+}
+
+void vad_batch_free(vad_batch_t *batch) {
+  if (batch == nullptr) {
+    return;
+  }
+
+#ifndef SILERO_VAD_NO_ORT
+  if (batch->model != nullptr && batch->model->g_ort != nullptr) {
+    const auto g = batch->model->g_ort;
+    if (batch->binding != nullptr)
+      g->ReleaseIoBinding(batch->binding);
+    g->ReleaseValue(batch->input_ort);
+    g->ReleaseValue(batch->state_ort);
+    g->ReleaseValue(batch->sr_ort);
+    g->ReleaseValue(batch->output_ort);
+    g->ReleaseValue(batch->state_out_ort);
+  }
+#endif
+  vad_model_release(batch->model);
+
+  if (batch->streams != nullptr) {
+    for (size_t i = 0; i < batch->batch_size; i++) {
+      vad_stream_free(&batch->streams[i]);
+    }
+  }
+
+  free(batch->streams);
+  free(batch->input_buffer);
+  free(batch->state);
+  free(batch->state_out);
+  free(batch->output_buffer);
+  free(batch->sr_tensor_data);
+  free(batch->rows);
+  memset(batch, 0, sizeof(*batch));
 }
@@ -0,0 +1,674 @@
+/*
+    vad_native.c - ONNX Runtime-free Silero VAD v5 inference in C23.
+
+    Weights file (little-endian), written by tools/extract_weights.py:
+      "SVADNET1", u32 net_count, then per net
+        u32 sample_rate, filter_length, hop_length, pad_right, hidden
+        u32 in, out, kernel, stride, padding        (x4 encoder layers)
+        f32 basis      [2 * bins][1][filter_length]
+        f32 conv w, b  [out][in][kernel], [out]     (x4)
+        f32 lstm W, R  [4 * hidden][in], [4 * hidden][hidden]
+        f32 lstm B     [8 * hidden]
+        f32 decoder w, b [1][hidden][1], [1]
+    Tensors keep their ONNX layout on disk and are repacked once at load.
+*/
+
+#include <math.h>
+#include <stdckdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vad_native.h"
+
+/* --- Constants --- */
+
+static const char native_magic[8] = {'S', 'V', 'A', 'D', 'N', 'E', 'T', '1'};
+
+// Fixed scratch bounds, so a window runs entirely on the stack
+constexpr size_t native_max_samples = 1'024U; // padded window, or one row
+constexpr size_t native_max_frames = 8U;
+constexpr size_t native_max_width = 512U; // channels or LSTM gates
+constexpr size_t native_max_stage = 6'144U; // activations of one window
+
+/* --- Loading --- */
+
+typedef struct {
+  const unsigned char *data;
+  size_t left;
+} native_reader_t;
+
+[[nodiscard]]
+static bool read_u32(native_reader_t *r, unsigned int *value) {
+  if (r->left < 4U) {
+    return false;
+  }
+  *value = (unsigned int)r->data[0] | (unsigned int)r->data[1] << 8 |
+           (unsigned int)r->data[2] << 16 | (unsigned int)r->data[3] << 24;
+  r->data += 4;
+  r->left -= 4U;
+  return true;
+}
+
+// Reserve `count` floats of the file; nullptr if it is truncated
+[[nodiscard]]
+static const unsigned char *take_floats(native_reader_t *r, size_t count) {
+  if (count > r->left / sizeof(float)) {
+    return nullptr;
+  }
+  const auto p = r->data;
+  r->data += count * sizeof(float);
+  r->left -= count * sizeof(float);
+  return p;
+}
+
+static float load_f32(const unsigned char *p, size_t index) {
+  float value;
+  memcpy(&value, p + index * sizeof(float), sizeof(float));
+  return value;
+}
+
+// File offsets of one net's tensors, between the two load passes
+typedef struct {
+  const unsigned char *basis;
+  const unsigned char *conv_weight[VAD_NATIVE_ENCODER_LAYERS];
+  const unsigned char *conv_bias[VAD_NATIVE_ENCODER_LAYERS];
+  const unsigned char *lstm_w;
+  const unsigned char *lstm_r;
+  const unsigned char *lstm_b;
+  const unsigned char *decoder_w;
+  const unsigned char *decoder_b;
+} native_blobs_t;
+
+// Header and shape checks: everything the kernels index must stay within
+// the scratch bounds and chain from layer to layer.
+[[nodiscard]]
+static bool read_net(native_reader_t *r, vad_native_net_t *net,
+                     native_blobs_t *blobs, size_t *floats) {
+  unsigned int sample_rate = 0;
+  if (!read_u32(r, &sample_rate) || !read_u32(r, &net->filter_length) ||
+      !read_u32(r, &net->hop_length) || !read_u32(r, &net->pad_right) ||
+      !read_u32(r, &net->hidden)) {
+    return false;
+  }
+  net->sample_rate = (int)sample_rate;
+  net->bins = net->filter_length / 2U + 1U;
+
+  for (size_t i = 0; i < VAD_NATIVE_ENCODER_LAYERS; i++) {
+    auto conv = &net->encoder[i];
+    if (!read_u32(r, &conv->in_channels) ||
+        !read_u32(r, &conv->out_channels) ||
+        !read_u32(r, &conv->kernel_size) || !read_u32(r, &conv->stride) ||
+        !read_u32(r, &conv->padding)) {
+      return false;
+    }
+    const unsigned int in_expected =
+        i == 0U ? net->bins : net->encoder[i - 1U].out_channels;
+    if (conv->in_channels != in_expected || conv->out_channels == 0U ||
+        conv->out_channels > native_max_width || conv->kernel_size == 0U ||
+        conv->kernel_size * conv->in_channels > native_max_samples ||
+        conv->stride == 0U || conv->padding >= conv->kernel_size) {
+      return false;
+    }
+  }
+  net->lstm_input = net->encoder[VAD_NATIVE_ENCODER_LAYERS - 1].out_channels;
+
+  if (net->filter_length < 2U || net->filter_length > native_max_samples ||
+      net->hop_length == 0U || 2U * net->bins > native_max_width ||
+      net->hidden == 0U || 4U * net->hidden > native_max_width ||
+      net->lstm_input + net->hidden > native_max_width) {
+    return false;
+  }
+
+  const size_t width = 2U * net->bins;
+  const size_t gates = 4U * net->hidden;
+  size_t total = 0;
+
+  blobs->basis = take_floats(r, width * net->filter_length);
+  total += width * net->filter_length;
+  for (size_t i = 0; i < VAD_NATIVE_ENCODER_LAYERS; i++) {
+    const auto conv = &net->encoder[i];
+    const size_t count = (size_t)conv->out_channels * conv->in_channels *
+                         conv->kernel_size;
+    blobs->conv_weight[i] = take_floats(r, count);
+    blobs->conv_bias[i] = take_floats(r, conv->out_channels);
+    total += count + conv->out_channels;
+    if (blobs->conv_weight[i] == nullptr || blobs->conv_bias[i] == nullptr) {
+      return false;
+    }
+  }
+  blobs->lstm_w = take_floats(r, gates * net->lstm_input);
+  blobs->lstm_r = take_floats(r, gates * net->hidden);
+  blobs->lstm_b = take_floats(r, 2U * gates);
+  blobs->decoder_w = take_floats(r, net->hidden);
+  blobs->decoder_b = take_floats(r, 1U);
+  total += gates * (net->lstm_input + net->hidden) + gates + net->hidden;
+
+  *floats += total;
+  return blobs->basis != nullptr && blobs->lstm_w != nullptr &&
+         blobs->lstm_r != nullptr && blobs->lstm_b != nullptr &&
+         blobs->decoder_w != nullptr && blobs->decoder_b != nullptr;
+}
+
+// Copy one net out of the file into kernel layout; returns the next free slot
+static float *repack_net(vad_native_net_t *net, const native_blobs_t *blobs,
+                         float *dst) {
+  const size_t width = 2U * net->bins;
+  const size_t taps = net->filter_length;
+
+  // basis [width][1][taps] -> [taps][width]
+  for (size_t o = 0; o < width; o++) {
+    for (size_t f = 0; f < taps; f++) {
+      dst[f * width + o] = load_f32(blobs->basis, o * taps + f);
+    }
+  }
+  net->basis = dst;
+  dst += width * taps;
+
+  // conv [out][in][kernel] -> [kernel][in][out]
+  for (size_t i = 0; i < VAD_NATIVE_ENCODER_LAYERS; i++) {
+    auto conv = &net->encoder[i];
+    const size_t out = conv->out_channels;
+    const size_t in = conv->in_channels;
+    const size_t kernel = conv->kernel_size;
+    for (size_t co = 0; co < out; co++) {
+      for (size_t ci = 0; ci < in; ci++) {
+        for (size_t k = 0; k < kernel; k++) {
+          dst[(k * in + ci) * out + co] =
+              load_f32(blobs->conv_weight[i], (co * in + ci) * kernel + k);
+        }
+      }
+    }
+    conv->weight = dst;
+    dst += kernel * in * out;
+
+    for (size_t co = 0; co < out; co++) {
+      dst[co] = load_f32(blobs->conv_bias[i], co);
+    }
+    conv->bias = dst;
+    dst += out;
+  }
+
+  // W [gates][input] and R [gates][hidden] -> [input + hidden][gates]
+  const size_t gates = 4U * net->hidden;
+  const size_t input = net->lstm_input;
+  const size_t rows = input + net->hidden;
+  for (size_t g = 0; g < gates; g++) {
+    for (size_t c = 0; c < input; c++) {
+      dst[c * gates + g] = load_f32(blobs->lstm_w, g * input + c);
+    }
+    for (size_t c = 0; c < net->hidden; c++) {
+      dst[(input + c) * gates + g] =
+          load_f32(blobs->lstm_r, g * net->hidden + c);
+    }
+  }
+  net->lstm_weight = dst;
+  dst += rows * gates;
+
+  for (size_t g = 0; g < gates; g++) {
+    dst[g] = load_f32(blobs->lstm_b, g) + load_f32(blobs->lstm_b, gates + g);
+  }
+  net->lstm_bias = dst;
+  dst += gates;
+
+  for (size_t c = 0; c < net->hidden; c++) {
+    dst[c] = load_f32(blobs->decoder_w, c);
+  }
+  net->decoder_weight = dst;
+  dst += net->hidden;
+  net->decoder_bias = load_f32(blobs->decoder_b, 0);
+  return dst;
+}
+
+[[nodiscard]]
+bool vad_native_probe(const void *data, size_t size) {
+  return data != nullptr && size >= sizeof(native_magic) &&
+         memcmp(data, native_magic, sizeof(native_magic)) == 0;
+}
+
+[[nodiscard]]
+bool vad_native_probe_file(const char *path) {
+  if (path == nullptr) {
+    return false;
+  }
+  FILE *fp = fopen(path, "rb");
+  if (fp == nullptr) {
+    return false;
+  }
+  char head[sizeof(native_magic)];
+  const size_t n = fread(head, 1, sizeof(head), fp);
+  fclose(fp);
+  return vad_native_probe(head, n);
+}
+
+[[nodiscard]]
+vad_native_model_t *vad_native_load(const void *data, size_t size) {
+  if (!vad_native_probe(data, size)) {
+    return nullptr;
+  }
+
+  native_reader_t r = {(const unsigned char *)data + sizeof(native_magic),
+                       size - sizeof(native_magic)};
+  unsigned int net_count = 0;
+  if (!read_u32(&r, &net_count) || net_count == 0U || net_count > 2U) {
+    fprintf(stderr, "Malformed native weights header\n");
+    return nullptr;
+  }
+
+  auto model = (vad_native_model_t *)calloc(1, sizeof(vad_native_model_t));
+  if (model == nullptr) {
+    return nullptr;
+  }
+
+  // 1. Validate every header and locate the tensors
+  native_blobs_t blobs[2] = {};
+  size_t floats = 0;
+  for (size_t i = 0; i < net_count; i++) {
+    if (!read_net(&r, &model->nets[i], &blobs[i], &floats)) {
+      fprintf(stderr, "Malformed or truncated native weights (net %zu)\n", i);
+      free(model);
+      return nullptr;
+    }
+  }
+  model->net_count = net_count;
+
+  // 2. Repack into one aligned block
+  constexpr size_t alignment = 64U;
+  size_t bytes = 0;
+  if (ckd_mul(&bytes, floats, sizeof(float)) ||
+      ckd_add(&bytes, bytes, alignment - 1U)) {
+    free(model);
+    return nullptr;
+  }
+  bytes -= bytes % alignment;
+  model->weights = (float *)aligned_alloc(alignment, bytes);
+  if (model->weights == nullptr) {
+    free(model);
+    return nullptr;
+  }
+
+  float *dst = model->weights;
+  for (size_t i = 0; i < net_count; i++) {
+    dst = repack_net(&model->nets[i], &blobs[i], dst);
+  }
+  return model;
+}
+
+[[nodiscard]]
+vad_native_model_t *vad_native_load_file(const char *path) {
+  if (path == nullptr) {
+    return nullptr;
+  }
+  FILE *fp = fopen(path, "rb");
+  if (fp == nullptr) {
+    fprintf(stderr, "Cannot open native weights %s\n", path);
+    return nullptr;
+  }
+
+  unsigned char *data = nullptr;
+  long size = -1;
+  if (fseek(fp, 0, SEEK_END) == 0) {
+    size = ftell(fp);
+  }
+  if (size > 0 && fseek(fp, 0, SEEK_SET) == 0) {
+    data = (unsigned char *)malloc((size_t)size);
+  }
+  const bool ok =
+      data != nullptr && fread(data, 1, (size_t)size, fp) == (size_t)size;
+  fclose(fp);
+
+  auto model = ok ? vad_native_load(data, (size_t)size) : nullptr;
+  free(data);
+  return model;
+}
+
+void vad_native_free(vad_native_model_t *model) {
+  if (model == nullptr) {
+    return;
+  }
+  free(model->weights);
+  free(model);
+}
+
+[[nodiscard]]
+const vad_native_net_t *vad_native_net_for(const vad_native_model_t *model,
+                                           int sample_rate) {
+  if (model == nullptr) {
+    return nullptr;
+  }
+  for (size_t i = 0; i < model->net_count; i++) {
+    if (model->nets[i].sample_rate == sample_rate) {
+      return &model->nets[i];
+    }
+  }
+  return nullptr;
+}
+
+/* --- Shapes --- */
+// Per window, activations are frame-major ([frame][channel]) and carry the
+// zero frames the next convolution pads with, so an output frame's receptive
+// field is one contiguous row of kernel * in floats.
+
+static size_t conv_out_frames(const vad_native_conv_t *conv, size_t frames) {
+  const size_t span = frames + 2U * conv->padding;
+  if (span < conv->kernel_size) {
+    return 0U;
+  }
+  return (span - conv->kernel_size) / conv->stride + 1U;
+}
+
+static size_t stft_frames(const vad_native_net_t *net, size_t input_samples) {
+  return (input_samples + net->pad_right - net->filter_length) /
+             net->hop_length +
+         1U;
+}
+
+// Padding (in frames) of encoder layer i's input; none after the last layer
+static size_t layer_padding(const vad_native_net_t *net, size_t i) {
+  return i < VAD_NATIVE_ENCODER_LAYERS ? net->encoder[i].padding : 0U;
+}
+
+// Floats per window of the largest activation: the STFT accumulator or any
+// padded encoder input. Zero when the encoder does not reduce to one frame.
+static size_t stage_floats(const vad_native_net_t *net, size_t input_samples) {
+  size_t frames = stft_frames(net, input_samples);
+  size_t largest = frames * 2U * net->bins;
+  for (size_t i = 0; i < VAD_NATIVE_ENCODER_LAYERS; i++) {
+    const auto conv = &net->encoder[i];
+    const size_t stage = (frames + 2U * conv->padding) * conv->in_channels;
+    largest = stage > largest ? stage : largest;
+    frames = conv_out_frames(conv, frames);
+  }
+  return frames == 1U ? largest : 0U;
+}
+
+[[nodiscard]]
+bool vad_native_supports(const vad_native_net_t *net, size_t input_samples) {
+  if (net == nullptr || input_samples <= net->pad_right) {
+    return false;
+  }
+  const size_t padded = input_samples + net->pad_right;
+  if (padded > native_max_samples || padded < net->filter_length ||
+      stft_frames(net, input_samples) > native_max_frames) {
+    return false;
+  }
+  const size_t stage = stage_floats(net, input_samples);
+  return stage > 0U && stage <= native_max_stage;
+}
+
+[[nodiscard]]
+size_t vad_native_workspace_size(const vad_native_net_t *net,
+                                 size_t input_samples, size_t windows) {
+  if (!vad_native_supports(net, input_samples)) {
+    return 0U;
+  }
+  // Padded copies of the windows, then two ping-pong activation buffers
+  return windows * (input_samples + net->pad_right +
+                    2U * stage_floats(net, input_samples));
+}
+
+/* --- Kernels --- */
+// Every weight matrix is stored input-major ([k][n]). The product runs on
+// register tiles of tile_rows frames x tile_cols outputs: each weight vector
+// loaded feeds tile_rows multiply-adds, and the sums over k stay in
+// registers. Column blocks are the outer loop, so with many frames in one
+// call a block of weights is read from memory once and reused from L1 by
+// every tile. Frames may come from different windows; each output is summed
+// in k order, so results do not depend on how windows are grouped.
+
+constexpr size_t tile_rows = 4U;
+constexpr size_t tile_cols = 16U;
+
+static const float zero_row[native_max_samples];
+
+// Row r of a product is frame r % frames of window r / frames
+typedef struct {
+  const float *x;
+  size_t x_window; // stride between windows
+  size_t x_frame;  // stride between frames of a window
+  float *out;
+  size_t out_window;
+  size_t out_frame;
+  size_t windows;
+  size_t frames;
+} native_rows_t;
+
+static const float *row_in(const native_rows_t *rows, size_t r) {
+  return rows->x + r / rows->frames * rows->x_window +
+         r % rows->frames * rows->x_frame;
+}
+
+static float *row_out(const native_rows_t *rows, size_t r) {
+  return rows->out + r / rows->frames * rows->out_window +
+         r % rows->frames * rows->out_frame;
+}
+
+// out[r] += x[r] w for tile_rows rows, output columns [o, o + tile_cols).
+// One named accumulator per row keeps the whole tile in registers.
+static void tile_full(const float *const x[tile_rows],
+                      float *const out[tile_rows], const float *restrict w,
+                      size_t k_count, size_t n, size_t o) {
+  const float *x0 = x[0], *x1 = x[1], *x2 = x[2], *x3 = x[3];
+  float a0[tile_cols], a1[tile_cols], a2[tile_cols], a3[tile_cols];
+  for (size_t c = 0; c < tile_cols; c++) {
+    a0[c] = out[0][o + c];
+    a1[c] = out[1][o + c];
+    a2[c] = out[2][o + c];
+    a3[c] = out[3][o + c];
+  }
+  for (size_t k = 0; k < k_count; k++) {
+    const float *restrict wk = w + k * n + o;
+    const float v0 = x0[k], v1 = x1[k], v2 = x2[k], v3 = x3[k];
+    for (size_t c = 0; c < tile_cols; c++) {
+      a0[c] += wk[c] * v0;
+      a1[c] += wk[c] * v1;
+      a2[c] += wk[c] * v2;
+      a3[c] += wk[c] * v3;
+    }
+  }
+  for (size_t c = 0; c < tile_cols; c++) {
+    out[0][o + c] = a0[c];
+    out[1][o + c] = a1[c];
+    out[2][o + c] = a2[c];
+    out[3][o + c] = a3[c];
+  }
+}
+
+// A lone row gains nothing from tiling: stream the weights once, row by row
+static void gemv_row(const float *restrict x, float *restrict out,
+                     const float *restrict w, size_t k_count, size_t n) {
+  for (size_t k = 0; k < k_count; k++) {
+    const float *restrict wk = w + k * n;
+    const float v = x[k];
+    for (size_t c = 0; c < n; c++) {
+      out[c] += wk[c] * v;
+    }
+  }
+}
+
+// out[r] += x[r] w for every row, w being [k_count][n]
+static void matmul_acc(const native_rows_t *rows, const float *restrict w,
+                       size_t k_count, size_t n) {
+  const size_t count = rows->windows * rows->frames;
+  const size_t full_cols = n - n % tile_cols;
+  // 2-3 leftover rows share a tile with zero rows writing to a sink; a
+  // single one goes through gemv_row
+  const size_t tiled = count % tile_rows == 1U ? count - 1U : count;
+  float sink[native_max_width];
+
+  for (size_t o = 0; o < full_cols; o += tile_cols) {
+    for (size_t r = 0; r < tiled; r += tile_rows) {
+      const float *x[tile_rows];
+      float *out[tile_rows];
+      for (size_t i = 0; i < tile_rows; i++) {
+        const bool live = r + i < tiled;
+        x[i] = live ? row_in(rows, r + i) : zero_row;
+        out[i] = live ? row_out(rows, r + i) : sink;
+      }
+      tile_full(x, out, w, k_count, n, o);
+    }
+  }
+
+  // Columns past the last full tile
+  for (size_t r = 0; r < tiled; r++) {
+    const float *x = row_in(rows, r);
+    float *out = row_out(rows, r);
+    for (size_t o = full_cols; o < n; o++) {
+      float acc = out[o];
+      for (size_t k = 0; k < k_count; k++) {
+        acc += w[k * n + o] * x[k];
+      }
+      out[o] = acc;
+    }
+  }
+
+  if (tiled < count) {
+    gemv_row(row_in(rows, tiled), row_out(rows, tiled), w, k_count, n);
+  }
+}
+
+static float sigmoidf(float x) { return 1.0f / (1.0f + expf(-x)); }
+
+// Copy each window with its right reflect padding (edge sample not repeated)
+static void reflect_pad(const vad_native_net_t *net, const float *input,
+                        size_t stride, size_t input_samples, size_t windows,
+                        float *padded) {
+  const size_t length = input_samples + net->pad_right;
+  for (size_t w = 0; w < windows; w++) {
+    const float *signal = input + w * stride;
+    float *dst = padded + w * length;
+    memcpy(dst, signal, input_samples * sizeof(float));
+    for (size_t i = 0; i < net->pad_right; i++) {
+      dst[input_samples + i] = signal[input_samples - 2U - i];
+    }
+  }
+}
+
+void vad_native_encode(const vad_native_net_t *net, const float *input,
+                       size_t stride, size_t input_samples, size_t windows,
+                       float *workspace, float *features) {
+  const size_t length = input_samples + net->pad_right;
+  const size_t stage = stage_floats(net, input_samples);
+  float *padded = workspace;
+  float *a = padded + windows * length;
+  float *b = a + windows * stage;
+
+  // 1. STFT: frames are overlapping rows of the padded window
+  reflect_pad(net, input, stride, input_samples, windows, padded);
+  size_t frames = stft_frames(net, input_samples);
+  const size_t width = 2U * net->bins;
+  memset(b, 0, windows * stage * sizeof(float));
+  const native_rows_t stft = {
+      .x = padded, .x_window = length, .x_frame = net->hop_length,
+      .out = b, .out_window = stage, .out_frame = width,
+      .windows = windows, .frames = frames};
+  matmul_acc(&stft, net->basis, net->filter_length, width);
+
+  // 2. Magnitude into the first layer's padded input
+  size_t pad = layer_padding(net, 0U);
+  for (size_t w = 0; w < windows; w++) {
+    const float *spec = b + w * stage;
+    float *dst = a + w * stage;
+    memset(dst, 0, (frames + 2U * pad) * net->bins * sizeof(float));
+    dst += pad * net->bins;
+    for (size_t t = 0; t < frames; t++) {
+      const float *re = spec + t * width;
+      const float *im = re + net->bins;
+      for (size_t k = 0; k < net->bins; k++) {
+        dst[t * net->bins + k] = sqrtf(re[k] * re[k] + im[k] * im[k]);
+      }
+    }
+  }
+
+  // 3. Encoder: one product per layer, [kernel * in] x [out]
+  float *in = a;
+  float *out = b;
+  for (size_t i = 0; i < VAD_NATIVE_ENCODER_LAYERS; i++) {
+    const auto conv = &net->encoder[i];
+    const size_t cin = conv->in_channels;
+    const size_t cout = conv->out_channels;
+    const size_t out_frames = conv_out_frames(conv, frames);
+    const size_t next_pad = layer_padding(net, i + 1U);
+
+    for (size_t w = 0; w < windows; w++) {
+      float *dst = out + w * stage;
+      memset(dst, 0, next_pad * cout * sizeof(float));
+      dst += next_pad * cout;
+      for (size_t t = 0; t < out_frames; t++) {
+        memcpy(dst + t * cout, conv->bias, cout * sizeof(float));
+      }
+      memset(dst + out_frames * cout, 0, next_pad * cout * sizeof(float));
+    }
+
+    const native_rows_t rows = {
+        .x = in, .x_window = stage, .x_frame = conv->stride * cin,
+        .out = out + next_pad * cout, .out_window = stage, .out_frame = cout,
+        .windows = windows, .frames = out_frames};
+    matmul_acc(&rows, conv->weight, conv->kernel_size * cin, cout);
+
+    const size_t used = (out_frames + 2U * next_pad) * cout;
+    for (size_t w = 0; w < windows; w++) {
+      float *v = out + w * stage;
+      for (size_t j = 0; j < used; j++) {
+        v[j] = v[j] > 0.0f ? v[j] : 0.0f;
+      }
+    }
+
+    float *swap = in;
+    in = out;
+    out = swap;
+    frames = out_frames;
+    pad = next_pad;
+  }
+
+  // 4. Input half of the LSTM gates: bias + W x, for every window at once
+  const size_t gates = 4U * net->hidden;
+  for (size_t w = 0; w < windows; w++) {
+    memcpy(features + w * gates, net->lstm_bias, gates * sizeof(float));
+  }
+  const native_rows_t lstm = {.x = in, .x_window = stage,
+                              .out = features, .out_window = gates,
+                              .windows = windows, .frames = 1U};
+  matmul_acc(&lstm, net->lstm_weight, net->lstm_input, gates);
+}
+
+[[nodiscard]]
+float vad_native_decode(const vad_native_net_t *net, const float *features,
+                        const float *state, float *state_out) {
+  const size_t hidden = net->hidden;
+  const size_t gates = 4U * hidden;
+  const float *h = state;
+  const float *c = state + hidden;
+
+  // Recurrent half of the gates: acc = features + R h
+  float acc[native_max_width];
+  memcpy(acc, features, gates * sizeof(float));
+  const native_rows_t step = {.x = h, .out = acc, .windows = 1U, .frames = 1U};
+  matmul_acc(&step, net->lstm_weight + net->lstm_input * gates, hidden,
+             gates);
+
+  // h', c' = LSTMCell(x, (h, c)), then ReLU, 1x1 conv and sigmoid
+  float *h_out = state_out;
+  float *c_out = state_out + hidden;
+  float logit = net->decoder_bias;
+  for (size_t j = 0; j < hidden; j++) {
+    const float i_gate = sigmoidf(acc[j]);
+    const float o_gate = sigmoidf(acc[hidden + j]);
+    const float f_gate = sigmoidf(acc[2U * hidden + j]);
+    const float cell = tanhf(acc[3U * hidden + j]);
+    c_out[j] = f_gate * c[j] + i_gate * cell;
+    h_out[j] = o_gate * tanhf(c_out[j]);
+    logit += net->decoder_weight[j] * (h_out[j] > 0.0f ? h_out[j] : 0.0f);
+  }
+  return sigmoidf(logit);
+}
+
+[[nodiscard]]
+float vad_native_run(const vad_native_net_t *net, const float *input,
+                     size_t input_samples, const float *state,
+                     float *state_out) {
+  float workspace[native_max_samples + 2U * native_max_stage];
+  float features[native_max_width];
+  vad_native_encode(net, input, 0U, input_samples, 1U, workspace, features);
+  return vad_native_decode(net, features, state, state_out);
+}
@@ -0,0 +1,173 @@
+/*
+    vad_test.c - Consistency checks for the VAD library, run by `zig build
+    test`. Uses the same files as the demo: silero_vad.onnx, the weights
+    extracted from it (tools/extract_weights.py) and test.wav, or the WAV
+    file given as the only argument.
+    1. The native engine scores every window like ONNX Runtime, within
+       prob_tolerance (ORT builds only).
+    2. The sharded paths, parallel and batched, cut the same segments as a
+       single pass over a recording long enough to split.
+*/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "silero_vad.h"
+#include "wav.h"
+
+#ifndef SILERO_VAD_NO_ORT
+constexpr char onnx_path[] = "silero_vad.onnx";
+#endif
+constexpr char weights_path[] = "silero_vad.weights";
+
+constexpr int window_ms = 32;
+// Float summation order differs between the engines
+constexpr float prob_tolerance = 1e-3f;
+// Copies of the input back to back, so that every shard gets its warmup
+constexpr size_t tiles = 8;
+constexpr size_t shards = 4;
+
+[[nodiscard]]
+static bool stream_open(vad_stream_t *stream, const char *path,
+                        int sample_rate) {
+  vad_model_t *model = vad_model_load(path, nullptr);
+  if (model == nullptr) {
+    fprintf(stderr, "Cannot load %s\n", path);
+    return false;
+  }
+  const bool ready = vad_stream_init(stream, model, sample_rate, window_ms,
+                                     0.5f, 100, 30, 250, INFINITY);
+  vad_model_release(model);
+  return ready;
+}
+
+[[nodiscard]]
+static bool same_speeches(const char *what, const timestamp_vector_t *expect,
+                          const timestamp_vector_t *got) {
+  for (size_t i = 0; i < expect->size || i < got->size; i++) {
+    if (i >= expect->size || i >= got->size ||
+        expect->data[i].start != got->data[i].start ||
+        expect->data[i].end != got->data[i].end) {
+      fprintf(stderr, "FAIL %s: segment %zu of %zu/%zu differs\n", what, i,
+              expect->size, got->size);
+      return false;
+    }
+  }
+  printf("ok   %s: %zu segments\n", what, got->size);
+  return true;
+}
+
+/* --- Checks --- */
+
+#ifndef SILERO_VAD_NO_ORT
+[[nodiscard]]
+static bool check_native_probs(const wav_reader_t *reader) {
+  vad_stream_t ort;
+  vad_stream_t native;
+  if (!stream_open(&ort, onnx_path, reader->sample_rate)) {
+    return false;
+  }
+  if (!stream_open(&native, weights_path, reader->sample_rate)) {
+    vad_stream_free(&ort);
+    return false;
+  }
+
+  const size_t windows = vad_stream_window_count(&ort, reader->num_samples);
+  auto expect = (float *)calloc(windows, sizeof(float));
+  auto got = (float *)calloc(windows, sizeof(float));
+  bool ok = expect != nullptr && got != nullptr;
+  if (ok) {
+    vad_iterator_process_probs(&ort, reader->data, reader->num_samples,
+                               expect);
+    vad_iterator_process_probs(&native, reader->data, reader->num_samples,
+                               got);
+    float worst = 0.0f;
+    size_t worst_window = 0;
+    for (size_t i = 0; i < windows; i++) {
+      const float error = fabsf(expect[i] - got[i]);
+      if (error > worst) {
+        worst = error;
+        worst_window = i;
+      }
+    }
+    ok = worst <= prob_tolerance;
+    fprintf(ok ? stdout : stderr,
+            "%s native probabilities: max error %.2e at window %zu of %zu\n",
+            ok ? "ok  " : "FAIL", (double)worst, worst_window, windows);
+    if (ok) {
+      ok = same_speeches("native segments", &ort.speeches, &native.speeches);
+    }
+  }
+
+  free(expect);
+  free(got);
+  vad_stream_free(&ort);
+  vad_stream_free(&native);
+  return ok;
+}
+#endif
+
+[[nodiscard]]
+static bool check_shards(const char *path, const wav_reader_t *reader) {
+  const size_t length = reader->num_samples * tiles;
+  auto audio = (float *)malloc(length * sizeof(float));
+  if (audio == nullptr) {
+    return false;
+  }
+  for (size_t i = 0; i < tiles; i++) {
+    memcpy(&audio[i * reader->num_samples], reader->data,
+           reader->num_samples * sizeof(float));
+  }
+
+  vad_stream_t single;
+  vad_stream_t sharded;
+  vad_batch_t batch;
+  bool ok = false;
+  if (stream_open(&single, path, reader->sample_rate)) {
+    if (stream_open(&sharded, path, reader->sample_rate)) {
+      if (vad_batch_init(&batch, single.model, shards, reader->sample_rate,
+                         window_ms, 0.5f, 100, 30, 250, INFINITY)) {
+        vad_iterator_process(&single, audio, length);
+        vad_iterator_process_parallel(&sharded, audio, length, shards);
+        ok = same_speeches("parallel segments", &single.speeches,
+                           &sharded.speeches);
+        vad_iterator_process_batched(&sharded, &batch, audio, length);
+        ok = same_speeches("batched segments", &single.speeches,
+                           &sharded.speeches) &&
+             ok;
+        vad_batch_free(&batch);
+      }
+      vad_stream_free(&sharded);
+    }
+    vad_stream_free(&single);
+  }
+  free(audio);
+  return ok;
+}
+
+int main(int argc, char **argv) {
+  const char *input_file = argc > 1 ? argv[1] : "test.wav";
+  wav_reader_t reader;
+  if (!wav_reader_open(&reader, input_file)) {
+    return EXIT_FAILURE;
+  }
+  if (reader.num_channel != 1) {
+    fprintf(stderr, "%s: expected mono audio\n", input_file);
+    wav_reader_close(&reader);
+    return EXIT_FAILURE;
+  }
+
+  bool ok = true;
+#ifndef SILERO_VAD_NO_ORT
+  ok = check_native_probs(&reader) && ok;
+  printf("%s:\n", onnx_path);
+  ok = check_shards(onnx_path, &reader) && ok;
+#endif
+  printf("%s:\n", weights_path);
+  ok = check_shards(weights_path, &reader) && ok;
+
+  wav_reader_close(&reader);
+  printf("%s\n", ok ? "PASS" : "FAIL");
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
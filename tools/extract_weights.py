@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+"""Extract Silero VAD v5 weights from an ONNX model for the native engine.
+
+usage: tools/extract_weights.py silero_vad.onnx silero_vad.weights
+
+Each sample-rate branch of the graph (the 16 kHz and 8 kHz sides of the If,
+or the single graph of a 16k-only model) holds one STFT Conv, four encoder
+Convs, one LSTM and the 1x1 decoder Conv. Tensors are written in their ONNX
+layout; src/vad_native.c documents the file format and repacks at load.
+"""
+
+import struct
+import sys
+
+import numpy as np
+import onnx
+from onnx import numpy_helper
+
+MAGIC = b"SVADNET1"
+ENCODER_LAYERS = 4
+RATE_FOR_FILTER = {256: 16000, 128: 8000}
+
+
+def walk_graphs(graph):
+    yield graph
+    for node in graph.node:
+        for attr in node.attribute:
+            if attr.type == onnx.AttributeProto.GRAPH:
+                yield from walk_graphs(attr.g)
+            elif attr.type == onnx.AttributeProto.GRAPHS:
+                for sub in attr.graphs:
+                    yield from walk_graphs(sub)
+
+
+def collect_constants(model):
+    """Every initializer and Constant output, with Identity aliases resolved."""
+    values, aliases = {}, {}
+    for graph in walk_graphs(model.graph):
+        for tensor in graph.initializer:
+            values[tensor.name] = numpy_helper.to_array(tensor)
+        for node in graph.node:
+            if node.op_type == "Constant":
+                for attr in node.attribute:
+                    if attr.name == "value":
+                        values[node.output[0]] = numpy_helper.to_array(attr.t)
+            elif node.op_type == "Identity":
+                aliases[node.output[0]] = node.input[0]
+
+    def lookup(name):
+        while name not in values and name in aliases:
+            name = aliases[name]
+        return values.get(name)
+
+    return lookup
+
+
+def attribute(node, name, default):
+    for attr in node.attribute:
+        if attr.name == name:
+            return onnx.helper.get_attribute_value(attr)
+    return default
+
+
+def conv_params(node, const):
+    weight = const(node.input[1])
+    if weight is None:
+        raise ValueError(f"Conv {node.name}: weight is not a constant")
+    out_channels, in_channels, kernel = weight.shape
+    bias = const(node.input[2]) if len(node.input) > 2 and node.input[2] else None
+    if bias is None:
+        bias = np.zeros(out_channels, dtype=np.float32)
+
+    pads = list(attribute(node, "pads", [0, 0]))
+    strides = list(attribute(node, "strides", [1]))
+    if pads[0] != pads[-1]:
+        raise ValueError(f"Conv {node.name}: asymmetric padding {pads}")
+    if list(attribute(node, "dilations", [1])) != [1] or attribute(node, "group", 1) != 1:
+        raise ValueError(f"Conv {node.name}: dilated or grouped convolution")
+    return weight, bias, (in_channels, out_channels, kernel, strides[0], pads[0])
+
+
+def reflect_pad(graph, const, filter_length):
+    """Right padding of the reflect Pad feeding the STFT."""
+    for node in graph.node:
+        if node.op_type != "Pad" or attribute(node, "mode", b"constant") != b"reflect":
+            continue
+        pads = const(node.input[1]) if len(node.input) > 1 else None
+        if pads is None:
+            pads = np.array(attribute(node, "pads", []))
+        if pads.size:
+            return int(pads.reshape(-1)[-1])
+    default = filter_length // 4
+    print(f"note: reflect padding not found, assuming {default}", file=sys.stderr)
+    return default
+
+
+def extract_net(graph, const):
+    convs = [n for n in graph.node if n.op_type == "Conv"]
+    lstms = [n for n in graph.node if n.op_type == "LSTM"]
+    if len(convs) != ENCODER_LAYERS + 2 or len(lstms) != 1:
+        return None
+
+    stft, encoder, decoder, lstm = convs[0], convs[1:-1], convs[-1], lstms[0]
+    basis, _, (_, _, filter_length, hop_length, _) = conv_params(stft, const)
+    if filter_length not in RATE_FOR_FILTER:
+        raise ValueError(f"unexpected STFT filter length {filter_length}")
+
+    w, r = const(lstm.input[1]), const(lstm.input[2])
+    hidden = int(attribute(lstm, "hidden_size", r.shape[-1]))
+    b = const(lstm.input[3]) if len(lstm.input) > 3 and lstm.input[3] else None
+    if b is None:
+        b = np.zeros((1, 8 * hidden), dtype=np.float32)
+    if attribute(lstm, "direction", b"forward") != b"forward":
+        raise ValueError("only a forward LSTM is supported")
+
+    decoder_w, decoder_b, _ = conv_params(decoder, const)
+    header = [RATE_FOR_FILTER[filter_length], filter_length, hop_length,
+              reflect_pad(graph, const, filter_length), hidden]
+    tensors = [basis]
+    for node in encoder:
+        weight, bias, params = conv_params(node, const)
+        header.extend(params)
+        tensors.extend([weight, bias])
+    tensors.extend([w, r, b, decoder_w, decoder_b])
+    return header, tensors
+
+
+def main(argv):
+    if len(argv) != 3:
+        print(__doc__.strip().splitlines()[2], file=sys.stderr)
+        return 2
+
+    model = onnx.load(argv[1])
+    const = collect_constants(model)
+    nets = {}
+    for graph in walk_graphs(model.graph):
+        net = extract_net(graph, const)
+        if net is not None:
+            nets[net[0][0]] = net
+    if not nets:
+        print(f"{argv[1]}: no Silero VAD v5 graph found", file=sys.stderr)
+        return 1
+
+    with open(argv[2], "wb") as out:
+        out.write(MAGIC + struct.pack("<I", len(nets)))
+        for rate in sorted(nets, reverse=True):
+            header, tensors = nets[rate]
+            out.write(struct.pack(f"<{len(header)}I", *header))
+            for tensor in tensors:
+                out.write(np.ascontiguousarray(tensor, dtype="<f4").tobytes())
+            print(f"{rate} Hz: filter {header[1]}, hop {header[2]}, "
+                  f"hidden {header[4]}", file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,322 @@
+#!/usr/bin/env python3
+"""Quantize Silero VAD to int8 (QDQ), calibrated on your own audio.
+
+usage: tools/quantize_model.py [options] silero_vad.onnx silero_vad.int8.onnx test.wav [more.wav ...]
+
+ONNX Runtime's static quantizer only sees the top-level graph, while Silero
+keeps each sample rate's network in a branch of an If. Each branch is
+inlined into a flat model, calibrated on the audio resampled to its rate,
+quantized (Conv weights int8 per channel, activations uint8; the LSTM stays
+float) and put back into the If. The model is tagged with "quantization"
+metadata, which src/silero_vad.c reads at load.
+
+Every file is then run through both models at its own rate, and the report
+compares window decisions and the segments the library would cut.
+"""
+
+import argparse
+import os
+import sys
+import tempfile
+import time
+import wave
+
+import numpy as np
+import onnx
+import onnxruntime as ort
+from onnx import helper
+from onnxruntime.quantization import (CalibrationDataReader, QuantFormat,
+                                      QuantType, quantize_static)
+
+from extract_weights import RATE_FOR_FILTER, collect_constants
+
+WINDOW = {16000: 512, 8000: 256}
+CONTEXT = {16000: 64, 8000: 32}
+STATE_SHAPE = (2, 1, 128)
+INLINE_PREFIX = "inline_"
+METADATA_KEY = "quantization"
+
+# Segmentation defaults of the CLI (src/main.c)
+THRESHOLD = 0.5
+MIN_SILENCE_MS = 100
+MIN_SPEECH_MS = 250
+
+
+def read_wav(path):
+    """Mono float samples in [-1, 1] and the sample rate of a PCM file."""
+    with wave.open(path, "rb") as w:
+        width, channels, rate = w.getsampwidth(), w.getnchannels(), w.getframerate()
+        raw = w.readframes(w.getnframes())
+    if width == 1:
+        x = (np.frombuffer(raw, np.uint8).astype(np.float32) - 128.0) / 128.0
+    elif width == 2:
+        x = np.frombuffer(raw, "<i2").astype(np.float32) / 32768.0
+    elif width == 4:
+        x = np.frombuffer(raw, "<i4").astype(np.float32) / 2147483648.0
+    else:
+        raise ValueError(f"{path}: unsupported {8 * width}-bit samples")
+    return x.reshape(-1, channels).mean(axis=1), rate
+
+
+def resample(x, rate, target):
+    """Linear interpolation; good enough to calibrate activation ranges."""
+    if rate == target:
+        return x
+    n = len(x) * target // rate
+    t = np.arange(n) * (rate / target)
+    return np.interp(t, np.arange(len(x)), x).astype(np.float32)
+
+
+def session(model, threads=1):
+    options = ort.SessionOptions()
+    options.intra_op_num_threads = threads
+    options.inter_op_num_threads = threads
+    data = model if isinstance(model, str) else model.SerializeToString()
+    return ort.InferenceSession(data, options, providers=["CPUExecutionProvider"])
+
+
+def run_windows(sess, audio, rate, feeds=None):
+    """Probabilities of every window, the last one zero-padded, stepping the
+    state and context exactly like vad_iterator_process."""
+    window, context = WINDOW[rate], CONTEXT[rate]
+    count = -(-len(audio) // window)
+    padded = np.zeros(context + count * window, np.float32)
+    padded[context:context + len(audio)] = audio
+    state = np.zeros(STATE_SHAPE, np.float32)
+    sr = np.array([rate], np.int64)
+    probs = np.empty(count, np.float32)
+    for i in range(count):
+        feed = {"input": padded[None, i * window:i * window + context + window],
+                "state": state, "sr": sr}
+        if feeds is not None:
+            feeds.append(feed)
+        prob, state = sess.run(["output", "stateN"], feed)
+        probs[i] = prob.reshape(-1)[0]
+    return probs
+
+
+class WindowReader(CalibrationDataReader):
+    """Calibration windows with the state the float model carries into them."""
+
+    def __init__(self, feeds):
+        self.feeds = iter(feeds)
+
+    def get_next(self):
+        return next(self.feeds, None)
+
+
+# --- Branch inlining ---
+
+def top_level_if(model):
+    ifs = [node for node in model.graph.node if node.op_type == "If"]
+    if len(ifs) > 1:
+        raise ValueError("expected at most one top-level If")
+    return ifs[0] if ifs else None
+
+
+def graph_rate(graph, const):
+    """Sample rate of a graph, from the filter length of its STFT Conv."""
+    for node in graph.node:
+        if node.op_type == "Conv":
+            weight = const(node.input[1])
+            if weight is not None:
+                return RATE_FOR_FILTER.get(weight.shape[-1])
+    return None
+
+
+def branches(model, const):
+    """{rate: attribute name} of the If branches, or {rate: None} when the
+    model is a single-rate graph without one."""
+    node = top_level_if(model)
+    if node is None:
+        rate = graph_rate(model.graph, const)
+        if rate is None:
+            raise ValueError("no Silero VAD STFT found")
+        return {rate: None}
+    found = {}
+    for attr in node.attribute:
+        rate = graph_rate(attr.g, const)
+        if rate is not None:
+            found[rate] = attr.name
+    if not found:
+        raise ValueError(f"If {node.name}: no Silero VAD branch found")
+    return found
+
+
+def branch_graph(model, name):
+    for attr in top_level_if(model).attribute:
+        if attr.name == name:
+            return attr.g
+    raise KeyError(name)
+
+
+def inline(model, name):
+    """Flat copy of model with the If replaced by its branch `name`."""
+    flat = onnx.ModelProto()
+    flat.CopyFrom(model)
+    if name is None:
+        return flat
+    node = top_level_if(model)
+    branch = branch_graph(model, name)
+    nodes = []
+    for n in model.graph.node:
+        if n is not node:
+            nodes.append(n)
+            continue
+        nodes.extend(branch.node)
+        for inner, outer in zip(branch.output, node.output):
+            nodes.append(helper.make_node("Identity", [inner.name], [outer],
+                                          name=INLINE_PREFIX + outer))
+    del flat.graph.node[:]
+    flat.graph.node.extend(nodes)
+    flat.graph.initializer.extend(branch.initializer)
+    return flat
+
+
+def reinsert(model, name, quantized):
+    """Replace branch `name` with the quantized nodes of its flat model."""
+    if name is None:
+        model.graph.CopyFrom(quantized.graph)
+        return
+    outer_outputs = {out for node in model.graph.node if node.op_type != "If"
+                     for out in node.output}
+    outer_tensors = {t.name for t in model.graph.initializer}
+    branch = branch_graph(model, name)
+    nodes = [node for node in quantized.graph.node
+             if not node.name.startswith(INLINE_PREFIX)
+             and not outer_outputs.intersection(node.output)]
+    tensors = [t for t in quantized.graph.initializer
+               if t.name not in outer_tensors]
+    del branch.node[:]
+    branch.node.extend(nodes)
+    del branch.initializer[:]
+    branch.initializer.extend(tensors)
+
+
+# --- Report ---
+
+def segments(probs, rate, length):
+    """Port of vad_update / vad_finish with no speech length limit."""
+    window = WINDOW[rate]
+    min_silence = MIN_SILENCE_MS * rate // 1000
+    min_speech = MIN_SPEECH_MS * rate // 1000
+    found, start, temp_end, triggered, current = [], -1, 0, False, 0
+    for p in probs:
+        current += window
+        if p >= THRESHOLD:
+            temp_end = 0
+            if not triggered:
+                triggered, start = True, current - window
+        elif p < THRESHOLD - 0.15 and triggered:
+            if temp_end == 0:
+                temp_end = current
+            if current - temp_end >= min_silence and temp_end - start > min_speech:
+                found.append((start, temp_end))
+                start, temp_end, triggered = -1, 0, False
+    if start >= 0:
+        found.append((start, length))
+    return found
+
+
+def speech_mask(found, length):
+    mask = np.zeros(length, bool)
+    for start, end in found:
+        mask[start:end] = True
+    return mask
+
+
+def report(path, float_sess, int8_sess):
+    audio, rate = read_wav(path)
+    if rate not in WINDOW:
+        print(f"{path}: skipped, {rate} Hz", file=sys.stderr)
+        return
+    timings = []
+    for sess in (float_sess, int8_sess):
+        begin = time.perf_counter()
+        timings.append(run_windows(sess, audio, rate))
+        timings.append(time.perf_counter() - begin)
+    p_float, t_float, p_int8, t_int8 = timings
+
+    agree = np.mean((p_float >= THRESHOLD) == (p_int8 >= THRESHOLD))
+    delta = np.abs(p_float - p_int8)
+    s_float = segments(p_float, rate, len(audio))
+    s_int8 = segments(p_int8, rate, len(audio))
+    m_float = speech_mask(s_float, len(audio))
+    m_int8 = speech_mask(s_int8, len(audio))
+    union = np.count_nonzero(m_float | m_int8)
+    iou = np.count_nonzero(m_float & m_int8) / union if union else 1.0
+    per_window = 1e3 / len(p_float)
+
+    print(f"{path} ({rate} Hz, {len(p_float)} windows)")
+    print(f"  windows agree  {100 * agree:6.2f} %   mean |dp| {delta.mean():.4f}"
+          f"   max |dp| {delta.max():.4f}")
+    print(f"  segments       float {len(s_float)}, int8 {len(s_int8)}, "
+          f"speech IoU {iou:.4f}")
+    print(f"  time/window    float {t_float * per_window:.3f} ms, "
+          f"int8 {t_int8 * per_window:.3f} ms")
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(
+        description=__doc__.strip().splitlines()[0])
+    parser.add_argument("model", help="float32 silero_vad.onnx")
+    parser.add_argument("output", help="quantized model to write")
+    parser.add_argument("audio", nargs="+", help="PCM WAV files to calibrate on")
+    parser.add_argument("--max-windows", type=int, default=4000,
+                        help="calibration windows per sample rate (default 4000)")
+    parser.add_argument("--reduce-range", action="store_true",
+                        help="7-bit weights, avoids saturation on AVX2 "
+                             "hosts without VNNI")
+    args = parser.parse_args(argv[1:])
+
+    model = onnx.load(args.model)
+    const = collect_constants(model)
+    try:
+        rates = branches(model, const)
+    except ValueError as e:
+        print(f"{args.model}: {e}", file=sys.stderr)
+        return 1
+    clips = [read_wav(path) for path in args.audio]
+
+    quantized = onnx.ModelProto()
+    quantized.CopyFrom(model)
+    with tempfile.TemporaryDirectory() as tmp:
+        for rate, name in sorted(rates.items(), reverse=True):
+            flat = inline(model, name)
+            float_sess = session(flat)
+            feeds = []
+            for audio, clip_rate in clips:
+                run_windows(float_sess, resample(audio, clip_rate, rate), rate,
+                            feeds)
+            stride = max(1, -(-len(feeds) // args.max_windows))
+            print(f"{rate} Hz: calibrating on {len(feeds[::stride])} of "
+                  f"{len(feeds)} windows", file=sys.stderr)
+
+            flat_path = os.path.join(tmp, f"flat_{rate}.onnx")
+            int8_path = os.path.join(tmp, f"int8_{rate}.onnx")
+            onnx.save(flat, flat_path)
+            quantize_static(flat_path, int8_path, WindowReader(feeds[::stride]),
+                            quant_format=QuantFormat.QDQ,
+                            op_types_to_quantize=["Conv"], per_channel=True,
+                            reduce_range=args.reduce_range,
+                            activation_type=QuantType.QUInt8,
+                            weight_type=QuantType.QInt8)
+            int8 = onnx.load(int8_path)
+            reinsert(quantized, name, int8)
+            del quantized.opset_import[:]
+            quantized.opset_import.extend(int8.opset_import)
+
+    helper.set_model_props(quantized, {
+        **{p.key: p.value for p in model.metadata_props},
+        METADATA_KEY: "int8-qdq",
+    })
+    onnx.save(quantized, args.output)
+
+    float_sess, int8_sess = session(args.model), session(args.output)
+    for path in args.audio:
+        report(path, float_sess, int8_sess)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
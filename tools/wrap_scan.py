@@ -0,0 +1,109 @@
+#!/usr/bin/env python3
+"""Wrap Silero VAD in an ONNX Scan so one Run steps through many windows.
+
+usage: tools/wrap_scan.py silero_vad.onnx silero_vad_scan.onnx
+
+The wrapped model keeps the names of the original: input becomes [windows,
+batch, samples], each row still [context | chunk]; state is the state before
+the first window and stateN the one after the last; output is [windows,
+batch, 1]. The Scan body is the original graph, renamed but otherwise
+untouched, so every window computes exactly what one Run of the original
+would. sr reaches the body from the outer scope. src/silero_vad.c detects
+the extra input axis at load.
+"""
+
+import sys
+
+import onnx
+from onnx import helper
+
+# The body must not shadow the outer graph's names
+BODY_NAMES = {
+    "input": "window",
+    "state": "window_state",
+    "output": "window_output",
+    "stateN": "window_stateN",
+}
+
+
+def rename(graph, names):
+    """Rename values throughout graph and the subgraphs of its nodes."""
+    for node in graph.node:
+        inputs = [names.get(name, name) for name in node.input]
+        outputs = [names.get(name, name) for name in node.output]
+        del node.input[:]
+        node.input.extend(inputs)
+        del node.output[:]
+        node.output.extend(outputs)
+        for attr in node.attribute:
+            if attr.type == onnx.AttributeProto.GRAPH:
+                rename(attr.g, names)
+            elif attr.type == onnx.AttributeProto.GRAPHS:
+                for sub in attr.graphs:
+                    rename(sub, names)
+    for value in [*graph.input, *graph.output, *graph.value_info]:
+        value.name = names.get(value.name, value.name)
+
+
+def by_name(values, wanted):
+    found = {value.name: value for value in values}
+    missing = [name for name in wanted if name not in found]
+    if missing:
+        raise ValueError(f"not a Silero VAD graph: no {', '.join(missing)}")
+    return [found[name] for name in wanted]
+
+
+def wrap(model):
+    graph = model.graph
+    state, sr = by_name(graph.input, ["state", "sr"])
+    (state_n,) = by_name(graph.output, ["stateN"])
+    by_name(graph.input, ["input"])
+    by_name(graph.output, ["output"])
+
+    # Scan body: carried state first, then the scanned window; outputs alike
+    body = onnx.GraphProto()
+    body.CopyFrom(graph)
+    body.name = "silero_vad_window"
+    rename(body, BODY_NAMES)
+    inputs = by_name(body.input, ["window_state", "window"])
+    outputs = by_name(body.output, ["window_stateN", "window_output"])
+    del body.input[:]
+    body.input.extend(inputs)
+    del body.output[:]
+    body.output.extend(outputs)
+
+    scan = helper.make_node("Scan", ["state", "input"], ["stateN", "output"],
+                            name="windows", body=body, num_scan_inputs=1)
+    float_type = onnx.TensorProto.FLOAT
+    wrapped = helper.make_graph(
+        [scan], "silero_vad_scan",
+        [helper.make_tensor_value_info("input", float_type,
+                                       ["windows", "batch", "samples"]),
+         state, sr],
+        [helper.make_tensor_value_info("output", float_type,
+                                       ["windows", "batch", 1]),
+         state_n])
+
+    out = onnx.ModelProto()
+    out.CopyFrom(model)
+    out.graph.CopyFrom(wrapped)
+    return out
+
+
+def main(argv):
+    if len(argv) != 3:
+        print(__doc__.strip().splitlines()[2], file=sys.stderr)
+        return 2
+
+    try:
+        wrapped = wrap(onnx.load(argv[1]))
+    except ValueError as e:
+        print(f"{argv[1]}: {e}", file=sys.stderr)
+        return 1
+    with open(argv[2], "wb") as out:
+        out.write(wrapped.SerializeToString())
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))